@@ -0,0 +1,149 @@
+/**
+ * @file action_lanes.cpp
+ * @author melektron
+ * @brief executor for user actions that run in parallel to the motion sequence
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright FrenchBakery (c) 2023
+ *
+ */
+
+#include "action_lanes.hpp"
+
+
+ActionLanes::~ActionLanes()
+{
+    shutdown();
+}
+
+void ActionLanes::laneThreadFn(lane_t *lane)
+{
+    // the lane runs its actions under the hold taken by submit(). Sleeping
+    // on the clock gives it up, so an action can wait for time to pass.
+    clock->bindThread();
+
+    std::unique_lock lock(guard);
+    while (true)
+    {
+        lane->cv.wait(lock, [&] { return exiting || !lane->queue.empty(); });
+        if (exiting)
+        {
+            // the actions still waiting will never run
+            if (lane->busy)
+                clock->release();
+            lane->busy = false;
+            return;
+        }
+
+        auto action = std::move(lane->queue.front());
+        lane->queue.pop_front();
+
+        // run the action without blocking the other lanes
+        lock.unlock();
+        action.fn();
+        lock.lock();
+
+        unfinished.erase(action.id);
+        // every detached waiter gets a hold and releases it once attached again
+        auto waiters = clock_waiters.find(action.id);
+        if (waiters != clock_waiters.end())
+        {
+            for (int i = 0; i < waiters->second; i++)
+                clock->hold();
+            clock_waiters.erase(waiters);
+        }
+        if (lane->queue.empty())
+        {
+            lane->busy = false;
+            clock->release();
+        }
+        done_cv.notify_all();
+    }
+}
+
+void ActionLanes::setClock(std::shared_ptr<Clock> _clock)
+{
+    std::lock_guard lock(guard);
+    clock = _clock;
+}
+
+action_id_t ActionLanes::create()
+{
+    std::lock_guard lock(guard);
+    action_id_t id = next_id++;
+    unfinished.insert(id);
+    return id;
+}
+
+void ActionLanes::submit(int lane_number, action_id_t id, std::function<void()> fn)
+{
+    std::lock_guard lock(guard);
+    if (exiting)
+        return;
+
+    auto &lane = lanes[lane_number];
+    if (!lane)
+    {
+        lane = std::make_unique<lane_t>();
+        lane->thread = std::thread(&ActionLanes::laneThreadFn, this, lane.get());
+    }
+    if (!lane->busy)
+    {
+        lane->busy = true;
+        clock->hold();
+    }
+    lane->queue.push_back({id, std::move(fn)});
+    lane->cv.notify_one();
+}
+
+bool ActionLanes::isDone(action_id_t id)
+{
+    std::lock_guard lock(guard);
+    return unfinished.count(id) == 0;
+}
+
+void ActionLanes::awaitDone(action_id_t id)
+{
+    std::unique_lock lock(guard);
+    if (exiting || unfinished.count(id) == 0)
+        return;
+
+    // time has to be able to advance while the action is running
+    bool attached = clock->detach();
+    if (attached)
+        clock_waiters[id]++;
+
+    done_cv.wait(lock, [&] { return exiting || unfinished.count(id) == 0; });
+
+    if (!attached)
+        return;
+    clock->attach();
+    if (unfinished.count(id) == 0)
+        // hold handed over by the lane
+        clock->release();
+    else if (--clock_waiters[id] == 0)
+        // shutdown before the action completed
+        clock_waiters.erase(id);
+}
+
+bool ActionLanes::idle()
+{
+    std::lock_guard lock(guard);
+    return unfinished.empty();
+}
+
+void ActionLanes::shutdown()
+{
+    {
+        std::lock_guard lock(guard);
+        exiting = true;
+        // the lanes release their holds when they exit
+        for (auto &[number, lane] : lanes)
+            lane->cv.notify_all();
+        done_cv.notify_all();
+    }
+    for (auto &[number, lane] : lanes)
+        if (lane->thread.joinable())
+            lane->thread.join();
+}
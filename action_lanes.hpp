@@ -0,0 +1,116 @@
+/**
+ * @file action_lanes.hpp
+ * @author melektron
+ * @brief executor for user actions (servos, arm, claw, ...) that run in
+ * parallel to the motion sequence. Every lane is a worker thread that runs
+ * its actions one after another, different lanes run concurrently.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright FrenchBakery (c) 2023
+ *
+ */
+
+#pragma once
+
+#include <map>
+#include <set>
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <thread>
+#include <functional>
+#include <condition_variable>
+#include "clock.hpp"
+
+typedef int action_id_t;
+
+class ActionLanes
+{
+    struct action_t
+    {
+        action_id_t id;
+        std::function<void()> fn;
+    };
+
+    struct lane_t
+    {
+        std::thread thread;
+        std::deque<action_t> queue;
+        std::condition_variable cv;
+        // the lane holds the clock from the submit of an action until
+        // its queue is empty again (one hold per lane, not per action)
+        bool busy = false;
+    };
+
+    std::mutex guard;
+    std::condition_variable done_cv;
+    std::shared_ptr<Clock> clock = Clock::system();
+    std::map<int, std::unique_ptr<lane_t>> lanes;
+
+    // actions that have been created but not finished jet
+    std::set<action_id_t> unfinished;
+    action_id_t next_id = 0;
+    bool exiting = false;
+
+    // number of clock participants detached in awaitDone() per action. The
+    // lane takes a hold for each of them when the action completes.
+    std::map<action_id_t, int> clock_waiters;
+
+    void laneThreadFn(lane_t *lane);
+
+public:
+    ActionLanes() = default;
+    ~ActionLanes();
+    ActionLanes(const ActionLanes &) = delete;
+    ActionLanes &operator=(const ActionLanes &) = delete;
+
+    /**
+     * @brief sets the clock that is held while actions are pending
+     * so no time passes on a virtual clock between submitting and running an action.
+     * Must be called before the first action is submitted.
+     */
+    void setClock(std::shared_ptr<Clock> clock);
+
+    /**
+     * @brief reserves a new action id. The action counts as
+     * unfinished from now on until it was submitted and has completed.
+     *
+     * @return action_id_t new id
+     */
+    action_id_t create();
+
+    /**
+     * @brief queues an action for execution on a lane. The lane
+     * thread is started on first use.
+     *
+     * @param lane lane number
+     * @param id id returned by create()
+     * @param fn action to run
+     */
+    void submit(int lane, action_id_t id, std::function<void()> fn);
+
+    /**
+     * @return true - action has completed (or the id is unknown)
+     * @return false - action is waiting or running
+     */
+    bool isDone(action_id_t id);
+
+    /**
+     * @brief blocks until the action has completed. A thread attached to
+     * a virtual clock leaves the participants while waiting and
+     * continues before any time passes after the completion.
+     */
+    void awaitDone(action_id_t id);
+
+    /**
+     * @return true - no created action is unfinished
+     */
+    bool idle();
+
+    /**
+     * @brief stops all lane threads after their current action.
+     * Actions still waiting in a lane are dropped.
+     */
+    void shutdown();
+};
@@ -0,0 +1,121 @@
+/**
+ * @file command_bench.cpp
+ * @author melektron
+ * @brief load benchmark of the command socket against a simulated robot:
+ * round trip time of submitting batches and delivery of the completion
+ * events to a client that doesn't read them while the sequence runs.
+ * Standalone program, build from the repository root with:
+ * g++ -std=c++17 -O2 -D__SIMULATION -I. bench/command_bench.cpp command_server.cpp command_client.cpp
+ *     navigation.cpp simulation/simnav.cpp action_lanes.cpp clock.cpp realtime.cpp telemetry.cpp
+ *     trajectory.cpp path.cpp stall_detector.cpp -o command_bench -lrt -lpthread
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright FrenchBakery (c) 2023
+ *
+ */
+
+#ifndef __SIMULATION
+#error "the command benchmark runs against the simulated robot, build it with -D__SIMULATION"
+#endif
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include "../simulation/simnav.hpp"
+#include "../command_server.hpp"
+#include "../command_client.hpp"
+
+#define BENCH_PATH "/tmp/frenchbakery_command_bench.sock"
+#define BATCH_COMMANDS 32
+#define SUBMIT_BATCHES 3000
+// batches whose events are sent while the client isn't reading
+#define EVENT_BATCHES 100
+
+
+static void printPercentiles(const char *name, std::vector<double> &values)
+{
+    std::sort(values.begin(), values.end());
+    printf("%s: n=%zu p50=%.1f us p99=%.1f us max=%.1f us\n", name, values.size(),
+           values[values.size() / 2], values[values.size() * 99 / 100], values.back());
+}
+
+int main()
+{
+    // virtual time runs as fast as the sequence can execute the commands
+    auto clock = std::make_shared<VirtualClock>();
+    SimNav nav(8.15, 85.3, 0);
+    nav.setClock(clock);
+    nav.initialize();
+
+    CommandServer server(nav);
+    CommandClient client;
+    if (server.open(BENCH_PATH) != el::retcode::ok || client.open(BENCH_PATH) != el::retcode::ok)
+    {
+        printf("failed to open the command socket\n");
+        return 1;
+    }
+
+    CommandBatch batch;
+    for (int i = 0; i < BATCH_COMMANDS / 2; i++)
+    {
+        batch.driveDistance(0.01);
+        batch.rotateBy(0.001);
+    }
+
+    // queue the event batches, then let the sequence run while the client sleeps
+    uint32_t last_batch = 0;
+    for (int i = 0; i < EVENT_BATCHES; i++)
+    {
+        if (client.submit(batch, false, &last_batch) != el::retcode::ok)
+        {
+            printf("submit failed\n");
+            return 1;
+        }
+    }
+    auto sequence_start = std::chrono::steady_clock::now();
+    nav.startSequence();
+    while (!nav.sequenceComplete())
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    double sequence_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - sequence_start).count();
+
+    int completed = 0;
+    int dropped = 0;
+    int batches_done = 0;
+    cmd_event_t event;
+    while (client.nextEvent(event, 1000) == el::retcode::ok)
+    {
+        if (event.type == CMD_EVENT_COMPLETED)
+            completed++;
+        else if (event.type == CMD_EVENT_BATCH_DONE)
+            batches_done++;
+        else if (event.type == CMD_EVENT_OVERFLOW)
+            dropped += event.batch_id;
+        if (event.type == CMD_EVENT_BATCH_DONE && event.batch_id == last_batch)
+            break;
+    }
+    printf("sequence of %d commands: %.3f s\n", EVENT_BATCHES * BATCH_COMMANDS, sequence_s);
+    printf("events received: completed %d + dropped %d of %d, batch done %d of %d\n",
+           completed, dropped, EVENT_BATCHES * BATCH_COMMANDS, batches_done, EVENT_BATCHES);
+
+    // the sequence is complete, the batches are only queued and not started
+    std::vector<double> submit_times;
+    for (int i = 0; i < SUBMIT_BATCHES; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        if (client.submit(batch, false) != el::retcode::ok)
+        {
+            printf("submit failed\n");
+            return 1;
+        }
+        submit_times.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+    printPercentiles("submit round trip", submit_times);
+
+    client.close();
+    server.close();
+    nav.terminate();
+    return batches_done == EVENT_BATCHES && completed + dropped == EVENT_BATCHES * BATCH_COMMANDS ? 0 : 1;
+}
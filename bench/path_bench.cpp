@@ -0,0 +1,88 @@
+/**
+ * @file path_bench.cpp
+ * @author melektron
+ * @brief benchmark of the Path nearest point queries against the naive
+ * linear scan. Standalone program, build from the repository root with:
+ * g++ -std=c++17 -O2 -I. bench/path_bench.cpp path.cpp -o path_bench
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright FrenchBakery (c) 2023
+ *
+ */
+
+#include <cmath>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "../path.hpp"
+
+#define PATH_POINTS 5000
+#define QUERIES 100000
+#define CHECK_QUERIES 20000
+
+
+template <typename F>
+static double measureUs(const std::vector<el::vec2_t> &queries, double &checksum, F query)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (const auto &q : queries)
+        checksum += query(q);
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count() / queries.size();
+}
+
+int main()
+{
+    // winding test path of about 16 m
+    std::vector<el::vec2_t> points;
+    for (int i = 0; i < PATH_POINTS; i++)
+    {
+        double t = i * 0.01;
+        points.emplace_back(t * 10 + 30 * std::sin(t), 50 * std::cos(t * 0.7));
+    }
+    Path path;
+    if (path.build(points) != el::retcode::ok)
+    {
+        printf("failed to build the path\n");
+        return 1;
+    }
+    printf("path: %zu points, %.1f cm\n", path.size(), path.length());
+
+    // the grid search has to return the same distance as the linear scan for random points
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<double> coordinate(-100, 600);
+    int mismatches = 0;
+    for (int i = 0; i < CHECK_QUERIES; i++)
+    {
+        el::vec2_t q(coordinate(generator), coordinate(generator) * 0.3);
+        if (std::abs(path.closestPoint(q).distance - path.closestPointLinear(q).distance) > 1e-9)
+            mismatches++;
+    }
+    printf("grid vs linear mismatches: %d of %d\n", mismatches, CHECK_QUERIES);
+
+    // tracking queries: points slightly off the path, in driving order
+    std::vector<el::vec2_t> queries;
+    for (int i = 0; i < QUERIES; i++)
+    {
+        el::vec2_t p = path.pointAt(path.length() * i / QUERIES);
+        queries.emplace_back(p.x + 0.5, p.y - 0.3);
+    }
+
+    double checksum = 0;
+    double linear = measureUs(queries, checksum, [&](el::vec2_t q) { return path.closestPointLinear(q).s; });
+    double grid = measureUs(queries, checksum, [&](el::vec2_t q) { return path.closestPoint(q).s; });
+    double hint = 0;
+    double windowed = measureUs(queries, checksum, [&](el::vec2_t q)
+    {
+        hint = path.closestPointNear(q, hint).s;
+        return hint;
+    });
+
+    printf("closestPointLinear: %8.3f us/query\n", linear);
+    printf("closestPoint:       %8.3f us/query (%.0fx)\n", grid, linear / grid);
+    printf("closestPointNear:   %8.3f us/query (%.0fx)\n", windowed, linear / windowed);
+    printf("checksum %f\n", checksum);
+    return mismatches ? 1 : 0;
+}
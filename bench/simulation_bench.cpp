@@ -0,0 +1,112 @@
+/**
+ * @file simulation_bench.cpp
+ * @author melektron
+ * @brief runs the same mission loop on the simulated robot under a virtual
+ * clock several times. Reports the wall time per mission and fails if a run
+ * hangs or ends at a different virtual time than the first one.
+ * Standalone program, build from the repository root with:
+ * g++ -std=c++17 -O2 -D__SIMULATION -I. bench/simulation_bench.cpp navigation.cpp simulation/simnav.cpp
+ *     action_lanes.cpp clock.cpp realtime.cpp telemetry.cpp trajectory.cpp path.cpp stall_detector.cpp
+ *     -o simulation_bench -lrt -lpthread
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright FrenchBakery (c) 2023
+ *
+ */
+
+#ifndef __SIMULATION
+#error "the simulation benchmark runs against the simulated robot, build it with -D__SIMULATION"
+#endif
+
+#include <cmath>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <atomic>
+#include <unistd.h>
+#include "../simulation/simnav.hpp"
+
+#define RUNS 5
+#define MISSION_ITERATIONS 50
+// a run that takes longer than this in real time is considered hung
+#define WATCHDOG_S 60
+
+
+/**
+ * @brief drives a square pattern with two actions per iteration that sleep
+ * on the clock on the same lane
+ *
+ * @param attached run the mission from a thread attached to the clock
+ * @return int64_t virtual time at the end of the mission in ns
+ */
+static int64_t runMission(bool attached)
+{
+    auto clock = std::make_shared<VirtualClock>();
+    if (attached)
+        clock->attach();
+    SimNav nav;
+    nav.setClock(clock);
+    nav.initialize();
+
+    for (int i = 0; i < MISSION_ITERATIONS; i++)
+    {
+        nav.driveDistance(20);
+        nav.addAction([&] { clock->sleepMs(50); }, 0, 50);
+        auto second = nav.addAction([&] { clock->sleepMs(50); }, 0, 50);
+        nav.rotateBy(M_PI / 2);
+        nav.waitForAction(second);
+        // the sequence has to start right after initialize() as well
+        if (nav.startSequence() != el::retcode::ok)
+        {
+            printf("startSequence failed in iteration %d\n", i);
+            fflush(stdout);
+            _exit(1);
+        }
+        nav.awaitSequenceComplete();
+    }
+
+    int64_t end = clock->now();
+    nav.terminate();
+    if (attached)
+        clock->detach();
+    return end;
+}
+
+int main()
+{
+    std::atomic_bool done{false};
+    std::thread watchdog([&]
+    {
+        for (int i = 0; i < WATCHDOG_S * 10 && !done; i++)
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (!done)
+        {
+            printf("mission hung\n");
+            fflush(stdout);
+            _exit(1);
+        }
+    });
+
+    int failed = 0;
+    for (bool attached : {false, true})
+    {
+        int64_t first = 0;
+        for (int run = 0; run < RUNS; run++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            int64_t end = runMission(attached);
+            double wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            printf("%s run %d: virtual %.3f s, wall %.1f ms\n", attached ? "attached" : "detached", run, end / 1e9, wall_ms);
+            if (run == 0)
+                first = end;
+            else if (end != first)
+                failed++;
+        }
+    }
+
+    done = true;
+    watchdog.join();
+    printf("%s\n", failed ? "virtual end times differ" : "all runs ended at the same virtual time");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,105 @@
+/**
+ * @file telemetry_bench.cpp
+ * @author melektron
+ * @brief benchmark of the shared memory telemetry: time from publishing an
+ * update until a polling reader has a consistent copy of it, and the cost of
+ * a publish. Standalone program, build from the repository root with:
+ * g++ -std=c++17 -O2 -I. bench/telemetry_bench.cpp telemetry.cpp -o telemetry_bench -lrt -lpthread
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright FrenchBakery (c) 2023
+ *
+ */
+
+#include <ctime>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include "../telemetry.hpp"
+
+#define BENCH_NAME "/frenchbakery_telemetry_bench"
+#define UPDATES 20000
+// time between updates, the reader needs cpu time as well on single core targets
+#define UPDATE_SPACING_US 50
+
+
+static uint64_t nowNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void printPercentiles(const char *name, std::vector<uint64_t> &values)
+{
+    if (values.empty())
+    {
+        printf("%s: no samples\n", name);
+        return;
+    }
+    std::sort(values.begin(), values.end());
+    printf("%s: n=%zu p50=%lu ns p99=%lu ns max=%lu ns\n", name, values.size(),
+           values[values.size() / 2], values[values.size() * 99 / 100], values.back());
+}
+
+int main()
+{
+    TelemetryPublisher publisher;
+    TelemetryReader reader;
+    if (publisher.open(BENCH_NAME) != el::retcode::ok || reader.open(BENCH_NAME) != el::retcode::ok)
+    {
+        printf("failed to open the telemetry block\n");
+        return 1;
+    }
+
+    // the reader polls the sequence counter like a monitoring process would
+    std::atomic_bool stop{false};
+    std::vector<uint64_t> latencies;
+    latencies.reserve(UPDATES);
+    int torn = 0;
+    int failed = 0;
+    std::thread reader_thread([&]
+    {
+        uint64_t last = 0;
+        telemetry_data_t data;
+        while (!stop)
+        {
+            uint64_t sequence = reader.sequence();
+            if (sequence == last || (sequence & 1))
+                continue;
+            last = sequence;
+            if (reader.read(data) != el::retcode::ok)
+            {
+                failed++;
+                continue;
+            }
+            latencies.push_back(nowNs() - data.timestamp_ns);
+            // x and y are always published with the same value
+            if (data.x != data.y)
+                torn++;
+        }
+    });
+
+    std::vector<uint64_t> publish_times;
+    publish_times.reserve(UPDATES);
+    telemetry_data_t data = {};
+    for (int i = 0; i < UPDATES; i++)
+    {
+        data.x = data.y = i;
+        uint64_t start = nowNs();
+        publisher.publish(data);
+        publish_times.push_back(nowNs() - start);
+        std::this_thread::sleep_for(std::chrono::microseconds(UPDATE_SPACING_US));
+    }
+    stop = true;
+    reader_thread.join();
+
+    printPercentiles("publish", publish_times);
+    printPercentiles("publish to read", latencies);
+    printf("torn reads: %d, failed reads: %d\n", torn, failed);
+    return torn ? 1 : 0;
+}
@@ -0,0 +1,149 @@
+/**
+ * @file clock.cpp
+ * @author melektron
+ * @brief time source used by the sequence engine and the robot
+ * implementations
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright FrenchBakery (c) 2023
+ *
+ */
+
+#include <ctime>
+#include <cerrno>
+#include <algorithm>
+#include "clock.hpp"
+
+
+// virtual clock the current thread is bound to
+static thread_local const VirtualClock *bound_clock = nullptr;
+
+
+void Clock::sleepMs(int64_t ms)
+{
+    sleepUntil(now() + ms * 1000000);
+}
+
+std::shared_ptr<Clock> Clock::system()
+{
+    static std::shared_ptr<Clock> instance = std::make_shared<SystemClock>();
+    return instance;
+}
+
+
+int64_t SystemClock::now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000ll + ts.tv_nsec;
+}
+
+void SystemClock::sleepUntil(int64_t deadline_ns)
+{
+    timespec deadline;
+    deadline.tv_sec = deadline_ns / 1000000000;
+    deadline.tv_nsec = deadline_ns % 1000000000;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR);
+}
+
+
+VirtualClock::VirtualClock(int64_t start_ns)
+    : time(start_ns)
+{
+}
+
+void VirtualClock::advance()
+{
+    if (active > 0)
+        return;
+    if (!deadlines.empty())
+        time = std::max(time, *deadlines.begin());
+    else if (participants == 0 && !waiters.empty())
+        // nobody else moves the time, so the threads that aren't attached do
+        time = std::max(time, *waiters.begin());
+    else
+        return;
+    cv.notify_all();
+}
+
+bool VirtualClock::boundToThisThread() const
+{
+    return bound_clock == this;
+}
+
+int64_t VirtualClock::now()
+{
+    std::lock_guard lock(guard);
+    return time;
+}
+
+void VirtualClock::sleepUntil(int64_t deadline_ns)
+{
+    std::unique_lock lock(guard);
+    if (deadline_ns <= time)
+        return;
+
+    if (!boundToThisThread())
+    {
+        auto entry = waiters.insert(deadline_ns);
+        advance();
+        cv.wait(lock, [&] { return time >= deadline_ns; });
+        waiters.erase(entry);
+        // the next waiter continues if there still are no participants
+        advance();
+        return;
+    }
+
+    active--;
+    auto entry = deadlines.insert(deadline_ns);
+    advance();
+    cv.wait(lock, [&] { return time >= deadline_ns; });
+    deadlines.erase(entry);
+    active++;
+}
+
+void VirtualClock::attach()
+{
+    std::lock_guard lock(guard);
+    active++;
+    participants++;
+    bound_clock = this;
+}
+
+bool VirtualClock::detach()
+{
+    std::lock_guard lock(guard);
+    if (!boundToThisThread())
+        return false;
+    active--;
+    participants--;
+    bound_clock = nullptr;
+    advance();
+    return true;
+}
+
+void VirtualClock::hold()
+{
+    std::lock_guard lock(guard);
+    active++;
+}
+
+void VirtualClock::release()
+{
+    std::lock_guard lock(guard);
+    active--;
+    advance();
+}
+
+void VirtualClock::bindThread()
+{
+    bound_clock = this;
+}
+
+void VirtualClock::advanceBy(int64_t ns)
+{
+    std::lock_guard lock(guard);
+    time += ns;
+    cv.notify_all();
+}
@@ -0,0 +1,150 @@
+/**
+ * @file clock.hpp
+ * @author melektron
+ * @brief time source used by the sequence engine and the robot
+ * implementations. The system clock sleeps in real time, the virtual
+ * clock lets simulations run as fast as the CPU allows while
+ * still producing the same results on every run.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright FrenchBakery (c) 2023
+ *
+ */
+
+#pragma once
+
+#include <set>
+#include <mutex>
+#include <memory>
+#include <cstdint>
+#include <condition_variable>
+
+class Clock
+{
+public:
+    virtual ~Clock() = default;
+
+    /**
+     * @return int64_t monotonic time in ns
+     */
+    virtual int64_t now() = 0;
+
+    /**
+     * @brief blocks until the absolute time deadline_ns has been reached
+     *
+     * @param deadline_ns absolute time in ns
+     */
+    virtual void sleepUntil(int64_t deadline_ns) = 0;
+
+    /**
+     * @brief blocks for the specified time
+     *
+     * @param ms duration in ms
+     */
+    void sleepMs(int64_t ms);
+
+    /**
+     * @brief makes the calling thread a participant of the clock. For a virtual
+     * clock, time only advances while all participants are sleeping on
+     * the clock. No effect on the system clock.
+     */
+    virtual void attach() {}
+
+    /**
+     * @brief removes the calling thread from the participants
+     * 
+     * @return true - the thread was attached before
+     */
+    virtual bool detach() { return false; }
+
+    /**
+     * @brief prevents time from advancing until release() is called
+     * (from any thread). Used to hand work to another thread without time
+     * passing in between. No effect on the system clock.
+     */
+    virtual void hold() {}
+
+    /**
+     * @brief ends a hold()
+     */
+    virtual void release() {}
+
+    /**
+     * @brief lets the calling thread give up its hold while
+     * sleeping. This is what attach() does in addition to hold().
+     */
+    virtual void bindThread() {}
+
+    /**
+     * @return std::shared_ptr<Clock> process wide real time clock
+     */
+    static std::shared_ptr<Clock> system();
+};
+
+/**
+ * @brief real time clock based on CLOCK_MONOTONIC
+ */
+class SystemClock : public Clock
+{
+public:
+    virtual int64_t now() override;
+    virtual void sleepUntil(int64_t deadline_ns) override;
+};
+
+/**
+ * @brief discrete event clock for simulations.
+ * Time only moves when every participant (attached thread or hold) is
+ * sleeping. It then jumps directly to the earliest deadline of the
+ * participants, so nothing ever waits in real time and the order of
+ * events only depends on the deadlines. Threads that aren't attached
+ * just wait until the participants have advanced the time far enough.
+ * Once there are no participants at all (e.g. the last one detached),
+ * time jumps to the earliest deadline of those threads instead.
+ */
+class VirtualClock : public Clock
+{
+    std::mutex guard;
+    std::condition_variable cv;
+    int64_t time = 0;
+    // participants that are currently not sleeping
+    int active = 0;
+    // number of attached threads
+    int participants = 0;
+    // deadlines of the sleeping participants
+    std::multiset<int64_t> deadlines;
+    // deadlines of the sleeping threads that aren't attached
+    std::multiset<int64_t> waiters;
+
+    /**
+     * @brief moves time to the earliest participant deadline if
+     * all participants are sleeping, or to the earliest deadline of the
+     * other threads if there are no participants. Called with guard locked.
+     */
+    void advance();
+
+    bool boundToThisThread() const;
+
+public:
+    /**
+     * @param start_ns initial time
+     */
+    VirtualClock(int64_t start_ns = 0);
+
+    virtual int64_t now() override;
+    virtual void sleepUntil(int64_t deadline_ns) override;
+
+    virtual void attach() override;
+    virtual bool detach() override;
+    virtual void hold() override;
+    virtual void release() override;
+    virtual void bindThread() override;
+
+    /**
+     * @brief moves time forward manually, e.g. from a test
+     * without attached threads
+     *
+     * @param ns time to advance by
+     */
+    void advanceBy(int64_t ns);
+};
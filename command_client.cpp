@@ -0,0 +1,199 @@
+/**
+ * @file command_client.cpp
+ * @author melektron
+ * @brief client for the navigation command socket
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright FrenchBakery (c) 2023
+ *
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "command_client.hpp"
+
+
+void CommandBatch::add(cmd_record_t record)
+{
+    records.push_back(record);
+}
+
+void CommandBatch::add(uint8_t type, double a, double b, double c, uint8_t flags)
+{
+    cmd_record_t record = {};
+    record.type = type;
+    record.flags = flags;
+    record.a = a;
+    record.b = b;
+    record.c = c;
+    add(record);
+}
+
+void CommandBatch::driveDistance(double distance)
+{
+    add(CMD_DRIVE_DISTANCE, distance);
+}
+
+void CommandBatch::rotateBy(double angle)
+{
+    add(CMD_ROTATE_BY, angle);
+}
+
+void CommandBatch::rotateTo(double angle)
+{
+    add(CMD_ROTATE_TO, angle);
+}
+
+void CommandBatch::driveArc(double radius, double angle)
+{
+    add(CMD_DRIVE_ARC, radius, angle);
+}
+
+void CommandBatch::driveArcTo(el::vec2_t pos, bool bw)
+{
+    add(CMD_DRIVE_ARC_TO, pos.x, pos.y, 0, bw ? CMD_FLAG_BACKWARD : 0);
+}
+
+void CommandBatch::driveVector(el::vec2_t d, bool bw)
+{
+    add(CMD_DRIVE_VECTOR, d.x, d.y, 0, bw ? CMD_FLAG_BACKWARD : 0);
+}
+
+void CommandBatch::driveToPosition(el::vec2_t pos, bool bw)
+{
+    add(CMD_DRIVE_TO_POSITION, pos.x, pos.y, 0, bw ? CMD_FLAG_BACKWARD : 0);
+}
+
+void CommandBatch::driveSpline(const std::vector<pose_t> &waypoints, double wheel_velocity, double wheel_acceleration)
+{
+    for (const auto &waypoint : waypoints)
+        add(CMD_SPLINE_WAYPOINT, waypoint.position.x, waypoint.position.y, waypoint.rotation);
+    add(CMD_DRIVE_SPLINE, wheel_velocity, wheel_acceleration);
+}
+
+
+CommandClient::~CommandClient()
+{
+    close();
+}
+
+el::retcode CommandClient::open(const char *path)
+{
+    if (fd >= 0)
+        return el::retcode::err;
+
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path))
+        return el::retcode::err;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+
+    fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return el::retcode::err;
+    if (connect(fd, (sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        bool missing = errno == ENOENT || errno == ECONNREFUSED;
+        ::close(fd);
+        fd = -1;
+        return missing ? el::retcode::nak : el::retcode::err;
+    }
+    pending.clear();
+    return el::retcode::ok;
+}
+
+void CommandClient::close()
+{
+    if (fd < 0)
+        return;
+    ::close(fd);
+    fd = -1;
+}
+
+el::retcode CommandClient::receive(cmd_event_t &event, int timeout_ms)
+{
+    if (fd < 0)
+        return el::retcode::err;
+
+    pollfd pfd = {fd, POLLIN, 0};
+    int ready = poll(&pfd, 1, timeout_ms);
+    if (ready == 0)
+        return el::retcode::nak;
+    if (ready < 0)
+        return errno == EINTR ? el::retcode::nak : el::retcode::err;
+
+    ssize_t size = recv(fd, &event, sizeof(event), 0);
+    if (size != sizeof(event))
+    {
+        close();
+        return el::retcode::err;
+    }
+    return el::retcode::ok;
+}
+
+el::retcode CommandClient::submit(const CommandBatch &batch, bool start, uint32_t *batch_id)
+{
+    if (fd < 0 || batch.size() > COMMAND_MAX_BATCH)
+        return el::retcode::err;
+
+    cmd_batch_header_t header = {};
+    header.magic = COMMAND_MAGIC;
+    header.version = COMMAND_VERSION;
+    header.count = batch.size();
+    header.batch_id = next_batch_id++;
+    header.flags = start ? CMD_BATCH_START : 0;
+
+    // send header and records as one message
+    iovec parts[2];
+    parts[0].iov_base = &header;
+    parts[0].iov_len = sizeof(header);
+    parts[1].iov_base = (void *)batch.getRecords().data();
+    parts[1].iov_len = batch.size() * sizeof(cmd_record_t);
+    msghdr message = {};
+    message.msg_iov = parts;
+    message.msg_iovlen = 2;
+    if (sendmsg(fd, &message, MSG_NOSIGNAL) < 0)
+        return el::retcode::err;
+
+    if (batch_id)
+        *batch_id = header.batch_id;
+
+    // the reply might come after events of earlier batches
+    cmd_event_t event;
+    while (receive(event, COMMAND_REPLY_TIMEOUT_MS) == el::retcode::ok)
+    {
+        if (event.type == CMD_EVENT_ACCEPTED && event.batch_id == header.batch_id)
+            return (el::retcode)event.status;
+        pending.push_back(event);
+    }
+    return el::retcode::err;
+}
+
+el::retcode CommandClient::nextEvent(cmd_event_t &event, int timeout_ms)
+{
+    if (!pending.empty())
+    {
+        event = pending.front();
+        pending.pop_front();
+        return el::retcode::ok;
+    }
+    return receive(event, timeout_ms);
+}
+
+el::retcode CommandClient::awaitBatch(uint32_t batch_id, int timeout_ms)
+{
+    cmd_event_t event;
+    while (true)
+    {
+        el::retcode result = nextEvent(event, timeout_ms);
+        if (result != el::retcode::ok)
+            return result;
+        if (event.type == CMD_EVENT_BATCH_DONE && event.batch_id == batch_id)
+            return el::retcode::ok;
+    }
+}
@@ -0,0 +1,127 @@
+/**
+ * @file command_client.hpp
+ * @author melektron
+ * @brief client for the navigation command socket. Lets a process that
+ * doesn't link the Navigation itself build command batches, submit them and
+ * wait for their completion.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright FrenchBakery (c) 2023
+ *
+ */
+
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <el/retcode.hpp>
+#include <el/vec.hpp>
+#include "command_protocol.hpp"
+#include "trajectory.hpp"
+
+// time to wait for the server to accept a batch
+#define COMMAND_REPLY_TIMEOUT_MS 1000
+
+/**
+ * @brief list of commands that is added to the sequence in one operation.
+ * The functions match the ones of Navigation.
+ */
+class CommandBatch
+{
+    std::vector<cmd_record_t> records;
+
+    void add(cmd_record_t record);
+    void add(uint8_t type, double a, double b = 0, double c = 0, uint8_t flags = 0);
+
+public:
+    void driveDistance(double distance);
+    void rotateBy(double angle);
+    void rotateTo(double angle);
+    void driveArc(double radius, double angle);
+    void driveArcTo(el::vec2_t pos, bool bw = false);
+    void driveVector(el::vec2_t d, bool bw = false);
+    void driveToPosition(el::vec2_t pos, bool bw = false);
+
+    /**
+     * @param waypoints poses to pass through
+     * @param wheel_velocity wheel velocity limit in cm/s (0 = limit of the robot)
+     * @param wheel_acceleration wheel acceleration limit in cm/s^2 (0 = limit of the robot)
+     */
+    void driveSpline(const std::vector<pose_t> &waypoints, double wheel_velocity = 0, double wheel_acceleration = 0);
+
+    void clear() { records.clear(); }
+    size_t size() const { return records.size(); }
+    const std::vector<cmd_record_t> &getRecords() const { return records; }
+};
+
+class CommandClient
+{
+    int fd = -1;
+    uint32_t next_batch_id = 1;
+    // events received while waiting for something else
+    std::deque<cmd_event_t> pending;
+
+    /**
+     * @brief receives one event from the socket
+     *
+     * @retval ok - event received
+     * @retval nak - timeout
+     * @retval err - connection closed
+     */
+    el::retcode receive(cmd_event_t &event, int timeout_ms);
+
+public:
+    CommandClient() = default;
+    ~CommandClient();
+    CommandClient(const CommandClient &) = delete;
+    CommandClient &operator=(const CommandClient &) = delete;
+
+    /**
+     * @brief connects to a CommandServer
+     *
+     * @param path socket path of the server
+     * @retval ok - connected
+     * @retval nak - no server listening (jet)
+     * @retval err - already connected or socket error
+     */
+    el::retcode open(const char *path = COMMAND_DEFAULT_PATH);
+
+    void close();
+
+    /**
+     * @brief sends a batch and waits until the server has added it to the sequence
+     *
+     * @param batch commands to add (at most COMMAND_MAX_BATCH)
+     * @param start start the sequence after adding the commands
+     * @param batch_id set to the id used in the events of the batch
+     * @retval ok - batch added
+     * @retval err - batch rejected, no reply or not connected
+     */
+    el::retcode submit(const CommandBatch &batch, bool start = true, uint32_t *batch_id = nullptr);
+
+    /**
+     * @brief returns the next completion event
+     *
+     * @param event received event
+     * @param timeout_ms maximum time to wait (-1 = forever)
+     * @retval ok - event received
+     * @retval nak - timeout
+     * @retval err - connection closed
+     */
+    el::retcode nextEvent(cmd_event_t &event, int timeout_ms = -1);
+
+    /**
+     * @brief waits until all commands of a batch have completed. Events
+     * received before that are discarded.
+     *
+     * @param batch_id id returned by submit()
+     * @param timeout_ms maximum time to wait for each event (-1 = forever)
+     * @retval ok - batch completed
+     * @retval nak - timeout
+     * @retval err - connection closed
+     */
+    el::retcode awaitBatch(uint32_t batch_id, int timeout_ms = -1);
+
+    bool isOpen() const { return fd >= 0; }
+};
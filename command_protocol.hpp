@@ -0,0 +1,112 @@
+/**
+ * @file command_protocol.hpp
+ * @author melektron
+ * @brief binary protocol of the navigation command socket. Used by the
+ * CommandServer and CommandClient to pass command batches and completion
+ * events between processes over a SOCK_SEQPACKET Unix socket, so every
+ * message is one datagram and needs no framing.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright FrenchBakery (c) 2023
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#define COMMAND_DEFAULT_PATH "/tmp/frenchbakery_navigation.sock"
+#define COMMAND_MAGIC 0x464e4342  // "FNCB"
+#define COMMAND_VERSION 1
+// maximum number of commands in one batch
+#define COMMAND_MAX_BATCH 256
+
+/**
+ * @brief command types of a batch record
+ */
+enum cmd_record_type_t : uint8_t
+{
+    CMD_DRIVE_DISTANCE = 1,     // a: distance in cm
+    CMD_ROTATE_BY,              // a: angle in radians
+    CMD_ROTATE_TO,              // a: angle in radians
+    CMD_DRIVE_ARC,              // a: radius in cm, b: angle in radians
+    CMD_DRIVE_ARC_TO,           // a, b: target position, flags: CMD_FLAG_BACKWARD
+    CMD_DRIVE_VECTOR,           // a, b: vector, flags: CMD_FLAG_BACKWARD
+    CMD_DRIVE_TO_POSITION,      // a, b: target position, flags: CMD_FLAG_BACKWARD
+    CMD_SPLINE_WAYPOINT,        // a, b: position, c: rotation. Collected for the next CMD_DRIVE_SPLINE
+    CMD_DRIVE_SPLINE,           // a: wheel velocity, b: wheel acceleration (0 = limit of the robot)
+};
+
+#define CMD_FLAG_BACKWARD 0x01
+
+/**
+ * @brief one command of a batch
+ */
+struct cmd_record_t
+{
+    uint8_t type;
+    uint8_t flags;
+    uint16_t reserved;
+    uint32_t reserved2;
+    double a;
+    double b;
+    double c;
+};
+
+/**
+ * @brief header of a batch message, followed by `count` records
+ */
+struct cmd_batch_header_t
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+    // chosen by the client and repeated in all events of the batch
+    uint32_t batch_id;
+    uint32_t flags;
+};
+
+// start the sequence after the batch has been added
+#define CMD_BATCH_START 0x01
+
+/**
+ * @brief event types sent from the server to the client
+ */
+enum cmd_event_type_t : uint8_t
+{
+    CMD_EVENT_ACCEPTED = 1,     // batch added to the sequence (status ok) or rejected (status err)
+    CMD_EVENT_COMPLETED,        // command `index` of the batch has completed (status ok) or couldn't be started (status err)
+    CMD_EVENT_BATCH_DONE,       // all commands of the batch have completed
+    CMD_EVENT_OVERFLOW,         // batch_id: number of COMPLETED events dropped in place of this one
+};
+
+/*
+ * The server queues the events of a client that doesn't read them up to a
+ * limit. Beyond it, the oldest COMPLETED events are dropped and replaced by a
+ * single CMD_EVENT_OVERFLOW event at the position of the first dropped one,
+ * which counts all events dropped until it is sent. ACCEPTED and BATCH_DONE
+ * events are never dropped, so awaiting a batch always works.
+ */
+
+/**
+ * @brief event message, the pose is the navigation pose when the event was sent
+ */
+struct cmd_event_t
+{
+    uint32_t batch_id;
+    uint16_t index;
+    uint8_t type;
+    // el::retcode of the operation
+    int8_t status;
+    double x;
+    double y;
+    double rotation;
+};
+
+static_assert(sizeof(cmd_record_t) == 32, "unexpected command record layout");
+static_assert(sizeof(cmd_batch_header_t) == 16, "unexpected batch header layout");
+static_assert(sizeof(cmd_event_t) == 32, "unexpected event layout");
+
+#define COMMAND_MAX_MESSAGE (sizeof(cmd_batch_header_t) + COMMAND_MAX_BATCH * sizeof(cmd_record_t))
@@ -0,0 +1,368 @@
+/**
+ * @file command_server.cpp
+ * @author melektron
+ * @brief Unix socket server for command batches
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright FrenchBakery (c) 2023
+ *
+ */
+
+#include <cmath>
+#include <cerrno>
+#include <atomic>
+#include <cstring>
+#include <algorithm>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "command_server.hpp"
+#include "navigation.hpp"
+
+
+CommandServer::CommandServer(Navigation &_nav, int _event_lane)
+    : nav(_nav), event_lane(_event_lane)
+{
+}
+
+CommandServer::~CommandServer()
+{
+    close();
+}
+
+el::retcode CommandServer::open(const char *_path)
+{
+    if (listen_fd >= 0 || strlen(_path) >= sizeof(path))
+        return el::retcode::err;
+
+    listen_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0)
+        return el::retcode::err;
+
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, _path, sizeof(addr.sun_path) - 1);
+    // remove the socket of a previous run
+    unlink(_path);
+    if (bind(listen_fd, (sockaddr *)&addr, sizeof(addr)) < 0 || listen(listen_fd, 8) < 0 || pipe2(wake_fds, O_CLOEXEC | O_NONBLOCK) < 0)
+    {
+        ::close(listen_fd);
+        listen_fd = -1;
+        unlink(_path);
+        return el::retcode::err;
+    }
+    strncpy(path, _path, sizeof(path) - 1);
+
+    threxit = false;
+    thread = std::thread(&CommandServer::serverThreadFn, this);
+    return el::retcode::ok;
+}
+
+void CommandServer::close()
+{
+    if (listen_fd < 0)
+        return;
+
+    threxit = true;
+    char wake = 0;
+    (void)!write(wake_fds[1], &wake, 1);
+    thread.join();
+
+    for (auto &connection : connections)
+        disconnect(*connection);
+    connections.clear();
+
+    ::close(listen_fd);
+    ::close(wake_fds[0]);
+    ::close(wake_fds[1]);
+    listen_fd = -1;
+    wake_fds[0] = wake_fds[1] = -1;
+    unlink(path);
+}
+
+void CommandServer::serverThreadFn()
+{
+    std::vector<uint8_t> message(COMMAND_MAX_MESSAGE);
+    std::vector<pollfd> fds;
+
+    while (!threxit)
+    {
+        fds.clear();
+        fds.push_back({wake_fds[0], POLLIN, 0});
+        fds.push_back({listen_fd, POLLIN, 0});
+        for (auto &connection : connections)
+        {
+            std::lock_guard lock(connection->write_guard);
+            short events = connection->outbox.empty() ? POLLIN : POLLIN | POLLOUT;
+            fds.push_back({connection->fd, events, 0});
+        }
+
+        if (poll(fds.data(), fds.size(), -1) < 0)
+            continue;
+        if (threxit)
+            break;
+
+        // events were queued, the next poll includes their connections
+        if (fds[0].revents & POLLIN)
+        {
+            char wake[64];
+            while (read(wake_fds[0], wake, sizeof(wake)) > 0);
+        }
+
+        // handle existing clients first, new connections are appended to the list
+        for (size_t i = 2; i < fds.size(); i++)
+        {
+            auto &connection = connections[i - 2];
+            if (fds[i].revents & POLLOUT)
+                flushEvents(*connection);
+            if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR)))
+                continue;
+            // MSG_TRUNC returns the full size of oversized messages
+            ssize_t size = recv(connection->fd, message.data(), message.size(), MSG_TRUNC | MSG_DONTWAIT);
+            if (size < 0 && (errno == EAGAIN || errno == EINTR))
+                continue;
+            if (size <= 0)
+            {
+                disconnect(*connection);
+                continue;
+            }
+            handleBatch(connection, message.data(), size);
+        }
+
+        // remove closed connections
+        for (auto it = connections.begin(); it != connections.end();)
+        {
+            if ((*it)->open)
+                it++;
+            else
+                it = connections.erase(it);
+        }
+
+        if (fds[1].revents & POLLIN)
+        {
+            int fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd >= 0)
+            {
+                auto connection = std::make_shared<connection_t>();
+                connection->fd = fd;
+                connection->wake_fd = wake_fds[1];
+                connections.push_back(connection);
+            }
+        }
+    }
+}
+
+void CommandServer::disconnect(connection_t &connection)
+{
+    std::lock_guard lock(connection.write_guard);
+    if (!connection.open)
+        return;
+    connection.open = false;
+    ::close(connection.fd);
+}
+
+void CommandServer::sendEvent(Navigation &nav, connection_t &connection, uint32_t batch_id, uint16_t index, cmd_event_type_t type, el::retcode status)
+{
+    // the kept pose is changed by the sequence, read it under the sequence lock
+    pose_t pose = nav.getOdometryPose();
+
+    cmd_event_t event = {};
+    event.batch_id = batch_id;
+    event.index = index;
+    event.type = type;
+    event.status = (int8_t)status;
+    event.x = pose.position.x;
+    event.y = pose.position.y;
+    event.rotation = pose.rotation;
+
+    std::lock_guard lock(connection.write_guard);
+    if (!connection.open)
+        return;
+    // never block the caller (possibly the sequence)
+    if (connection.outbox.empty())
+    {
+        if (send(connection.fd, &event, sizeof(event), MSG_NOSIGNAL | MSG_DONTWAIT) >= 0)
+            return;
+        // a broken connection is removed once the server thread reads from it
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+            return;
+    }
+
+    if (connection.outbox.size() >= COMMAND_MAX_QUEUED_EVENTS)
+    {
+        // count the dropped events in the queued overflow event or replace
+        // the oldest COMPLETED event by a new one
+        auto overflow = std::find_if(connection.outbox.begin(), connection.outbox.end(), [](const cmd_event_t &queued)
+        {
+            return queued.type == CMD_EVENT_OVERFLOW;
+        });
+        auto oldest = std::find_if(overflow == connection.outbox.end() ? connection.outbox.begin() : overflow,
+                                   connection.outbox.end(), [](const cmd_event_t &queued)
+        {
+            return queued.type == CMD_EVENT_COMPLETED;
+        });
+        if (oldest != connection.outbox.end())
+        {
+            if (overflow != connection.outbox.end())
+            {
+                overflow->batch_id++;
+                connection.outbox.erase(oldest);
+            }
+            else
+            {
+                oldest->type = CMD_EVENT_OVERFLOW;
+                oldest->batch_id = 1;
+                oldest->index = 0;
+                oldest->status = (int8_t)el::retcode::nak;
+            }
+        }
+    }
+    connection.outbox.push_back(event);
+
+    // the server thread has to wait for the socket to become writable
+    char wake = 0;
+    (void)!write(connection.wake_fd, &wake, 1);
+}
+
+void CommandServer::flushEvents(connection_t &connection)
+{
+    std::lock_guard lock(connection.write_guard);
+    while (connection.open && !connection.outbox.empty())
+    {
+        if (send(connection.fd, &connection.outbox.front(), sizeof(cmd_event_t), MSG_NOSIGNAL | MSG_DONTWAIT) < 0)
+            return;
+        connection.outbox.pop_front();
+    }
+}
+
+void CommandServer::handleBatch(const std::shared_ptr<connection_t> &connection, const uint8_t *message, size_t size)
+{
+    if (size < sizeof(cmd_batch_header_t))
+    {
+        sendEvent(nav, *connection, 0, 0, CMD_EVENT_ACCEPTED, el::retcode::err);
+        return;
+    }
+    cmd_batch_header_t header;
+    memcpy(&header, message, sizeof(header));
+    auto reject = [&]
+    {
+        sendEvent(nav, *connection, header.batch_id, 0, CMD_EVENT_ACCEPTED, el::retcode::err);
+    };
+
+    if (header.magic != COMMAND_MAGIC || header.version != COMMAND_VERSION || header.count > COMMAND_MAX_BATCH
+        || size != sizeof(header) + header.count * sizeof(cmd_record_t))
+        return reject();
+
+    std::vector<cmd_record_t> records(header.count);
+    memcpy(records.data(), message + sizeof(header), header.count * sizeof(cmd_record_t));
+
+    // validate everything before the first command is added
+    size_t waypoints = 0;
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        const auto &record = records[i];
+        if (record.type < CMD_DRIVE_DISTANCE || record.type > CMD_DRIVE_SPLINE)
+            return reject();
+        if (!std::isfinite(record.a) || !std::isfinite(record.b) || !std::isfinite(record.c))
+            return reject();
+        if (record.type == CMD_SPLINE_WAYPOINT)
+        {
+            // same checks as Navigation::driveSpline()
+            if (waypoints)
+            {
+                const auto &previous = records[i - 1];
+                if (record.a == previous.a && record.b == previous.b)
+                    return reject();
+            }
+            waypoints++;
+        }
+        else if (record.type == CMD_DRIVE_SPLINE)
+        {
+            if (waypoints == 0 || record.a < 0 || record.b < 0)
+                return reject();
+            waypoints = 0;
+        }
+        else if (waypoints)
+            return reject();
+    }
+    if (waypoints)
+        return reject();
+
+    {
+        // the sequence can't start any of the commands until all are added
+        auto lock = nav.lockSequence();
+
+        std::vector<pose_t> spline;
+        for (size_t i = 0; i < records.size(); i++)
+        {
+            const auto &record = records[i];
+            bool bw = record.flags & CMD_FLAG_BACKWARD;
+            // set by the sequence if a spline can't be started
+            std::shared_ptr<std::atomic_bool> failed;
+            switch (record.type)
+            {
+            case CMD_DRIVE_DISTANCE:
+                nav.driveDistance(record.a);
+                break;
+            case CMD_ROTATE_BY:
+                nav.rotateBy(record.a);
+                break;
+            case CMD_ROTATE_TO:
+                nav.rotateTo(record.a);
+                break;
+            case CMD_DRIVE_ARC:
+                nav.driveArc(record.a, record.b);
+                break;
+            case CMD_DRIVE_ARC_TO:
+                nav.driveArcTo(el::vec2_t(record.a, record.b), bw);
+                break;
+            case CMD_DRIVE_VECTOR:
+                nav.driveVector(el::vec2_t(record.a, record.b), bw);
+                break;
+            case CMD_DRIVE_TO_POSITION:
+                nav.driveToPosition(el::vec2_t(record.a, record.b), bw);
+                break;
+            case CMD_SPLINE_WAYPOINT:
+                spline.push_back({el::vec2_t(record.a, record.b), record.c});
+                // the waypoints belong to the following spline command
+                continue;
+            case CMD_DRIVE_SPLINE:
+            {
+                // 0 selects the limit of the robot
+                trajectory_limits_t limits;
+                limits.wheel_velocity = record.a;
+                limits.wheel_acceleration = record.b;
+                failed = std::make_shared<std::atomic_bool>(false);
+                nav.driveSpline(spline, limits, [failed] { *failed = true; });
+                spline.clear();
+                break;
+            }
+            }
+
+            // report once the command has reached its target
+            uint32_t batch_id = header.batch_id;
+            uint16_t index = i;
+            bool last = i + 1 == records.size();
+            // the action may outlive the server, so it only keeps the connection
+            Navigation &events_nav = nav;
+            nav.addAction([&events_nav, connection, batch_id, index, last, failed]
+            {
+                sendEvent(events_nav, *connection, batch_id, index, CMD_EVENT_COMPLETED, failed && *failed ? el::retcode::err : el::retcode::ok);
+                if (last)
+                    sendEvent(events_nav, *connection, batch_id, index, CMD_EVENT_BATCH_DONE, el::retcode::ok);
+            }, event_lane, 100);
+        }
+
+        // reply before the first event can be sent
+        sendEvent(nav, *connection, header.batch_id, header.count, CMD_EVENT_ACCEPTED, el::retcode::ok);
+        if (records.empty())
+            sendEvent(nav, *connection, header.batch_id, 0, CMD_EVENT_BATCH_DONE, el::retcode::ok);
+    }
+
+    // fails if the sequence is running already, which then continues with the new commands
+    if (header.flags & CMD_BATCH_START)
+        nav.startSequence();
+}
@@ -0,0 +1,106 @@
+/**
+ * @file command_server.hpp
+ * @author melektron
+ * @brief Unix socket server that lets other processes (e.g. the strategy
+ * or a scripting runtime) add command batches to the sequence of a Navigation
+ * and receive completion events. See command_protocol.hpp for the message format.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright FrenchBakery (c) 2023
+ *
+ */
+
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <el/retcode.hpp>
+#include "command_protocol.hpp"
+
+class Navigation;
+
+// action lane the completion events are sent from
+#define COMMAND_EVENT_LANE 1000
+// events kept for a client that doesn't read them. Beyond this, the oldest
+// COMPLETED events are dropped and counted in a CMD_EVENT_OVERFLOW event,
+// ACCEPTED and BATCH_DONE are always kept.
+#define COMMAND_MAX_QUEUED_EVENTS 1024
+
+class CommandServer
+{
+    struct connection_t
+    {
+        int fd;
+        // write end of the wake pipe of the server
+        int wake_fd;
+        // events are queued from the action lane and the server thread
+        std::mutex write_guard;
+        bool open = true;
+        // events the socket couldn't take yet, sent by the server thread once it is writable
+        std::deque<cmd_event_t> outbox;
+    };
+
+    Navigation &nav;
+    int event_lane;
+
+    int listen_fd = -1;
+    // pipe used to wake the server thread up when closing or when events are queued
+    int wake_fds[2] = {-1, -1};
+    char path[108] = {0};
+    std::vector<std::shared_ptr<connection_t>> connections;
+
+    std::atomic_bool threxit{false};
+    std::thread thread;
+    void serverThreadFn();
+
+    /**
+     * @brief checks a batch message and adds all of its commands to the
+     * sequence in one operation, or none if the batch is invalid
+     */
+    void handleBatch(const std::shared_ptr<connection_t> &connection, const uint8_t *message, size_t size);
+
+    static void disconnect(connection_t &connection);
+
+    /**
+     * @brief sends an event without blocking. Events the socket can't take
+     * right now are queued and sent in order by the server thread.
+     */
+    static void sendEvent(Navigation &nav, connection_t &connection, uint32_t batch_id, uint16_t index, cmd_event_type_t type, el::retcode status);
+
+    /**
+     * @brief sends queued events until the socket is full
+     */
+    static void flushEvents(connection_t &connection);
+
+public:
+    /**
+     * @param nav navigation to add the commands to
+     * @param event_lane action lane used to send completion events. It must not be used for other actions.
+     */
+    CommandServer(Navigation &nav, int event_lane = COMMAND_EVENT_LANE);
+    ~CommandServer();
+    CommandServer(const CommandServer &) = delete;
+    CommandServer &operator=(const CommandServer &) = delete;
+
+    /**
+     * @brief creates the socket (replacing a stale one) and starts
+     * accepting clients on a background thread
+     *
+     * @param path socket path
+     * @retval ok - server running
+     * @retval err - already open or socket could not be created
+     */
+    el::retcode open(const char *path = COMMAND_DEFAULT_PATH);
+
+    /**
+     * @brief disconnects all clients and removes the socket
+     */
+    void close();
+
+    bool isOpen() const { return listen_fd >= 0; }
+};
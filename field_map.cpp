@@ -0,0 +1,76 @@
+/**
+ * @file field_map.cpp
+ * @author melektron
+ * @brief map of the game field used for localization
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright FrenchBakery (c) 2023
+ *
+ */
+
+#include <cmath>
+#include <algorithm>
+#include "field_map.hpp"
+
+
+void FieldMap::addWall(el::vec2_t a, el::vec2_t b)
+{
+    wall_x.push_back(a.x);
+    wall_y.push_back(a.y);
+    wall_dx.push_back(b.x - a.x);
+    wall_dy.push_back(b.y - a.y);
+}
+
+void FieldMap::addRectangle(el::vec2_t min, el::vec2_t max)
+{
+    addWall(el::vec2_t(min.x, min.y), el::vec2_t(max.x, min.y));
+    addWall(el::vec2_t(max.x, min.y), el::vec2_t(max.x, max.y));
+    addWall(el::vec2_t(max.x, max.y), el::vec2_t(min.x, max.y));
+    addWall(el::vec2_t(min.x, max.y), el::vec2_t(min.x, min.y));
+}
+
+void FieldMap::addLine(el::vec2_t a, el::vec2_t b, double width)
+{
+    lines.push_back({a, b, width / 2});
+}
+
+double FieldMap::raycast(double x, double y, double angle, double max_range) const
+{
+    double rx = std::cos(angle);
+    double ry = std::sin(angle);
+    double best = max_range;
+
+    // ray: p + t * r, wall: w + u * d, solve for t >= 0 and 0 <= u <= 1
+    size_t n = wall_x.size();
+    for (size_t i = 0; i < n; i++)
+    {
+        double denom = rx * wall_dy[i] - ry * wall_dx[i];
+        if (denom == 0)
+            continue;
+        double ox = wall_x[i] - x;
+        double oy = wall_y[i] - y;
+        double t = (ox * wall_dy[i] - oy * wall_dx[i]) / denom;
+        double u = (ox * ry - oy * rx) / denom;
+        if (t >= 0 && u >= 0 && u <= 1 && t < best)
+            best = t;
+    }
+    return best;
+}
+
+bool FieldMap::onLine(double x, double y) const
+{
+    for (const auto &line : lines)
+    {
+        double dx = line.b.x - line.a.x;
+        double dy = line.b.y - line.a.y;
+        double len2 = dx * dx + dy * dy;
+        double t = len2 > 0 ? ((x - line.a.x) * dx + (y - line.a.y) * dy) / len2 : 0;
+        t = std::clamp(t, 0.0, 1.0);
+        double ex = x - (line.a.x + t * dx);
+        double ey = y - (line.a.y + t * dy);
+        if (ex * ex + ey * ey <= line.half_width * line.half_width)
+            return true;
+    }
+    return false;
+}
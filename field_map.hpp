@@ -0,0 +1,79 @@
+/**
+ * @file field_map.hpp
+ * @author melektron
+ * @brief map of the game field used for localization. Contains walls
+ * that distance sensors can see and lines on the floor that line sensors detect.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright FrenchBakery (c) 2023
+ *
+ */
+
+#pragma once
+
+#include <vector>
+#include <el/vec.hpp>
+
+class FieldMap
+{
+    // walls stored as segment start points and direction vectors
+    std::vector<double> wall_x;
+    std::vector<double> wall_y;
+    std::vector<double> wall_dx;
+    std::vector<double> wall_dy;
+
+    struct line_t
+    {
+        el::vec2_t a;
+        el::vec2_t b;
+        double half_width;
+    };
+    std::vector<line_t> lines;
+
+public:
+    FieldMap() = default;
+
+    /**
+     * @brief adds a wall (or any obstacle edge) between two points
+     *
+     * @param a start point in cm
+     * @param b end point in cm
+     */
+    void addWall(el::vec2_t a, el::vec2_t b);
+
+    /**
+     * @brief adds the four walls of a rectangle
+     *
+     * @param min corner with the smaller coordinates
+     * @param max corner with the larger coordinates
+     */
+    void addRectangle(el::vec2_t min, el::vec2_t max);
+
+    /**
+     * @brief adds a line on the floor (e.g. black tape)
+     *
+     * @param a start point in cm
+     * @param b end point in cm
+     * @param width width of the line in cm
+     */
+    void addLine(el::vec2_t a, el::vec2_t b, double width);
+
+    /**
+     * @brief distance from a point to the first wall in a direction
+     *
+     * @param x ray origin x in cm
+     * @param y ray origin y in cm
+     * @param angle ray direction in radians
+     * @param max_range range returned if no wall is hit
+     * @return double distance in cm
+     */
+    double raycast(double x, double y, double angle, double max_range) const;
+
+    /**
+     * @return true - the point is on a line
+     */
+    bool onLine(double x, double y) const;
+
+    size_t wallCount() const { return wall_x.size(); }
+};
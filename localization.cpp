@@ -0,0 +1,381 @@
+/**
+ * @file localization.cpp
+ * @author melektron
+ * @brief optional map based localization using a particle filter
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright FrenchBakery (c) 2023
+ *
+ */
+
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+#include "localization.hpp"
+#include "navigation.hpp"
+
+
+ParticleFilter::ParticleFilter(const FieldMap &_map, particle_filter_config_t _config)
+    : map(_map), config(_config)
+{
+    size_t n = std::max<size_t>(config.particles, 1);
+    xs.assign(n, 0);
+    ys.assign(n, 0);
+    thetas.assign(n, 0);
+    log_weights.assign(n, 0);
+    weights.assign(n, 1.0 / n);
+    next_xs.resize(n);
+    next_ys.resize(n);
+    next_thetas.resize(n);
+
+    size_t threads = config.threads ? config.threads : std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, n);
+    for (size_t i = 0; i < threads; i++)
+        generators.emplace_back(config.seed + i);
+    // the calling thread processes the first chunk itself
+    for (size_t i = 1; i < threads; i++)
+        workers.emplace_back(&ParticleFilter::workerFn, this, i);
+}
+
+ParticleFilter::~ParticleFilter()
+{
+    {
+        std::lock_guard lock(pool_guard);
+        exiting = true;
+    }
+    pool_cv.notify_all();
+    for (auto &worker : workers)
+        worker.join();
+}
+
+void ParticleFilter::workerFn(size_t worker)
+{
+    uint64_t generation = 0;
+    std::unique_lock lock(pool_guard);
+    while (true)
+    {
+        pool_cv.wait(lock, [&] { return exiting || job_generation != generation; });
+        if (exiting)
+            return;
+        generation = job_generation;
+        auto fn = job;
+
+        lock.unlock();
+        size_t first, last;
+        chunk(worker, first, last);
+        fn(worker, first, last);
+        lock.lock();
+
+        if (--jobs_pending == 0)
+            done_cv.notify_all();
+    }
+}
+
+void ParticleFilter::chunk(size_t worker, size_t &first, size_t &last) const
+{
+    size_t n = xs.size();
+    size_t count = generators.size();
+    first = n * worker / count;
+    last = n * (worker + 1) / count;
+}
+
+void ParticleFilter::runParallel(std::function<void(size_t, size_t, size_t)> fn)
+{
+    {
+        std::lock_guard lock(pool_guard);
+        job = fn;
+        jobs_pending = workers.size();
+        job_generation++;
+    }
+    pool_cv.notify_all();
+
+    size_t first, last;
+    chunk(0, first, last);
+    fn(0, first, last);
+
+    std::unique_lock lock(pool_guard);
+    done_cv.wait(lock, [&] { return jobs_pending == 0; });
+}
+
+void ParticleFilter::addRangeSensor(const range_sensor_t &sensor)
+{
+    range_sensors.push_back(sensor);
+}
+
+void ParticleFilter::addLineSensor(const line_sensor_t &sensor)
+{
+    line_sensors.push_back(sensor);
+}
+
+void ParticleFilter::reset(const pose_t &pose, double position_spread, double rotation_spread)
+{
+    runParallel([&](size_t worker, size_t first, size_t last)
+    {
+        std::normal_distribution<double> position(0, position_spread);
+        std::normal_distribution<double> rotation(0, rotation_spread);
+        auto &gen = generators[worker];
+        for (size_t i = first; i < last; i++)
+        {
+            xs[i] = pose.position.x + position(gen);
+            ys[i] = pose.position.y + position(gen);
+            thetas[i] = pose.rotation + rotation(gen);
+        }
+    });
+    std::fill(weights.begin(), weights.end(), 1.0 / xs.size());
+}
+
+void ParticleFilter::predict(double forward, double lateral, double rotation)
+{
+    double distance = std::hypot(forward, lateral);
+    double distance_sigma = config.distance_noise * distance;
+    double rotation_sigma = config.rotation_noise * std::abs(rotation) + config.drift_noise * distance;
+
+    runParallel([&](size_t worker, size_t first, size_t last)
+    {
+        std::normal_distribution<double> distance_error(0, 1);
+        std::normal_distribution<double> rotation_error(0, 1);
+        auto &gen = generators[worker];
+        for (size_t i = first; i < last; i++)
+        {
+            double scale = 1 + (distance > 0 ? distance_sigma / distance * distance_error(gen) : 0);
+            double dtheta = rotation + rotation_sigma * rotation_error(gen);
+            // move along the average heading of the step
+            double heading = thetas[i] + dtheta / 2;
+            double c = std::cos(heading);
+            double s = std::sin(heading);
+            xs[i] += scale * (c * forward - s * lateral);
+            ys[i] += scale * (s * forward + c * lateral);
+            thetas[i] += dtheta;
+        }
+    });
+}
+
+el::retcode ParticleFilter::update(const observation_t &observation)
+{
+    if (observation.ranges.size() != range_sensors.size() || observation.lines.size() != line_sensors.size())
+        return el::retcode::err;
+
+    // log likelihood of every particle
+    runParallel([&](size_t, size_t first, size_t last)
+    {
+        for (size_t i = first; i < last; i++)
+        {
+            double c = std::cos(thetas[i]);
+            double s = std::sin(thetas[i]);
+            double log_weight = 0;
+
+            for (size_t k = 0; k < range_sensors.size(); k++)
+            {
+                const auto &sensor = range_sensors[k];
+                double sx = xs[i] + c * sensor.offset.x - s * sensor.offset.y;
+                double sy = ys[i] + s * sensor.offset.x + c * sensor.offset.y;
+                double expected = map.raycast(sx, sy, thetas[i] + sensor.angle, sensor.max_range);
+                double measured = std::min(observation.ranges[k], sensor.max_range);
+                double error = (measured - expected) / sensor.sigma;
+                // cap the penalty so a single bad reading can't eliminate all particles
+                log_weight -= std::min(0.5 * error * error, 12.5);
+            }
+
+            for (size_t k = 0; k < line_sensors.size(); k++)
+            {
+                const auto &sensor = line_sensors[k];
+                double sx = xs[i] + c * sensor.offset.x - s * sensor.offset.y;
+                double sy = ys[i] + s * sensor.offset.x + c * sensor.offset.y;
+                bool match = map.onLine(sx, sy) == observation.lines[k];
+                log_weight += std::log(match ? sensor.accuracy : 1 - sensor.accuracy);
+            }
+
+            log_weights[i] = log_weight;
+        }
+    });
+
+    // combine with the previous weights and normalize
+    size_t n = xs.size();
+    double max_log = -INFINITY;
+    for (size_t i = 0; i < n; i++)
+    {
+        log_weights[i] += std::log(weights[i]);
+        max_log = std::max(max_log, log_weights[i]);
+    }
+    double sum = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        weights[i] = std::exp(log_weights[i] - max_log);
+        sum += weights[i];
+    }
+    for (size_t i = 0; i < n; i++)
+        weights[i] /= sum;
+
+    if (effectiveSampleSize() < config.resample_threshold)
+        resample();
+
+    return el::retcode::ok;
+}
+
+void ParticleFilter::resample()
+{
+    // systematic resampling with a single random offset
+    size_t n = xs.size();
+    std::uniform_real_distribution<double> offset(0, 1.0 / n);
+    double position = offset(generators[0]);
+    double cumulative = weights[0];
+    size_t j = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        while (position > cumulative && j < n - 1)
+            cumulative += weights[++j];
+        next_xs[i] = xs[j];
+        next_ys[i] = ys[j];
+        next_thetas[i] = thetas[j];
+        position += 1.0 / n;
+    }
+    xs.swap(next_xs);
+    ys.swap(next_ys);
+    thetas.swap(next_thetas);
+    std::fill(weights.begin(), weights.end(), 1.0 / n);
+}
+
+pose_t ParticleFilter::estimate() const
+{
+    double x = 0, y = 0, c = 0, s = 0;
+    for (size_t i = 0; i < xs.size(); i++)
+    {
+        x += weights[i] * xs[i];
+        y += weights[i] * ys[i];
+        c += weights[i] * std::cos(thetas[i]);
+        s += weights[i] * std::sin(thetas[i]);
+    }
+    pose_t pose;
+    pose.position = el::vec2_t(x, y);
+    pose.rotation = std::atan2(s, c);
+    return pose;
+}
+
+double ParticleFilter::effectiveSampleSize() const
+{
+    double sum = 0;
+    for (double w : weights)
+        sum += w * w;
+    return 1 / (sum * xs.size());
+}
+
+
+SimulatedSensors::SimulatedSensors(const FieldMap &_map, uint32_t seed)
+    : map(_map), generator(seed)
+{
+}
+
+void SimulatedSensors::addRangeSensor(const range_sensor_t &sensor)
+{
+    range_sensors.push_back(sensor);
+}
+
+void SimulatedSensors::addLineSensor(const line_sensor_t &sensor)
+{
+    line_sensors.push_back(sensor);
+}
+
+observation_t SimulatedSensors::observe(const pose_t &pose)
+{
+    observation_t observation;
+    double c = std::cos(pose.rotation);
+    double s = std::sin(pose.rotation);
+
+    for (const auto &sensor : range_sensors)
+    {
+        double sx = pose.position.x + c * sensor.offset.x - s * sensor.offset.y;
+        double sy = pose.position.y + s * sensor.offset.x + c * sensor.offset.y;
+        double range = map.raycast(sx, sy, pose.rotation + sensor.angle, sensor.max_range);
+        std::normal_distribution<double> noise(0, sensor.sigma);
+        observation.ranges.push_back(std::clamp(range + noise(generator), 0.0, sensor.max_range));
+    }
+
+    for (const auto &sensor : line_sensors)
+    {
+        double sx = pose.position.x + c * sensor.offset.x - s * sensor.offset.y;
+        double sy = pose.position.y + s * sensor.offset.x + c * sensor.offset.y;
+        std::bernoulli_distribution correct(sensor.accuracy);
+        bool on_line = map.onLine(sx, sy);
+        observation.lines.push_back(correct(generator) ? on_line : !on_line);
+    }
+
+    return observation;
+}
+
+
+Localizer::Localizer(Navigation &_nav, ParticleFilter &_filter, std::function<observation_t()> _sensors)
+    : nav(_nav), filter(_filter), sensors(_sensors)
+{
+    last_pose = nav.getOdometryPose();
+}
+
+Localizer::~Localizer()
+{
+    stop();
+}
+
+el::retcode Localizer::update()
+{
+    std::lock_guard lock(update_guard);
+    auto start = std::chrono::steady_clock::now();
+
+    // odometry step since the last update in the frame of the last pose
+    pose_t odometry = nav.getOdometryPose();
+    double dx = odometry.position.x - last_pose.position.x;
+    double dy = odometry.position.y - last_pose.position.y;
+    double c = std::cos(last_pose.rotation);
+    double s = std::sin(last_pose.rotation);
+    filter.predict(c * dx + s * dy, -s * dx + c * dy, odometry.rotation - last_pose.rotation);
+    last_pose = odometry;
+
+    if (filter.update(sensors()) != el::retcode::ok)
+        return el::retcode::err;
+
+    pose_t corrected = filter.estimate();
+    // keep the number of full turns the navigation has counted
+    corrected.rotation = odometry.rotation + std::remainder(corrected.rotation - odometry.rotation, 2 * M_PI);
+    if (nav.correctPose(odometry, corrected) == el::retcode::ok)
+        last_pose = corrected;
+
+    last_update_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    return el::retcode::ok;
+}
+
+el::retcode Localizer::start(int period_ms)
+{
+    if (thread.joinable() || period_ms <= 0)
+        return el::retcode::err;
+
+    threxit = false;
+    // on a virtual clock, time waits for every update. No time may
+    // pass before the thread is attached, so it is held until then.
+    auto clock = nav.getClock();
+    clock->hold();
+    thread = std::thread([this, period_ms, clock]
+    {
+        clock->attach();
+        clock->release();
+        int64_t next = clock->now();
+        while (!threxit)
+        {
+            update();
+            next += (int64_t)period_ms * 1000000;
+            clock->sleepUntil(next);
+        }
+        clock->detach();
+    });
+    return el::retcode::ok;
+}
+
+void Localizer::stop()
+{
+    threxit = true;
+    // let time advance on a virtual clock so the thread can wake up
+    auto clock = nav.getClock();
+    bool attached = clock->detach();
+    if (thread.joinable())
+        thread.join();
+    if (attached)
+        clock->attach();
+}
@@ -0,0 +1,258 @@
+/**
+ * @file localization.hpp
+ * @author melektron
+ * @brief optional map based localization. A particle filter corrects the
+ * odometry pose of the navigation using distance and line sensor observations
+ * against a known field map.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright FrenchBakery (c) 2023
+ *
+ */
+
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <random>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+#include <el/retcode.hpp>
+#include <el/vec.hpp>
+#include "field_map.hpp"
+#include "trajectory.hpp"
+
+class Navigation;
+
+/**
+ * @brief distance sensor mounted on the robot
+ */
+struct range_sensor_t
+{
+    // position relative to the robot center (x forward, y left) in cm
+    el::vec2_t offset;
+    // direction relative to the robot in radians
+    double angle = 0;
+    // readings at or above this are treated as "nothing seen"
+    double max_range = 80;
+    // standard deviation of a reading in cm
+    double sigma = 2;
+};
+
+/**
+ * @brief floor line sensor mounted on the robot
+ */
+struct line_sensor_t
+{
+    // position relative to the robot center (x forward, y left) in cm
+    el::vec2_t offset;
+    // probability that the reading matches the floor
+    double accuracy = 0.9;
+};
+
+/**
+ * @brief one set of sensor readings, in the order the sensors were configured
+ */
+struct observation_t
+{
+    std::vector<double> ranges;
+    std::vector<bool> lines;
+};
+
+/**
+ * @brief motion and resampling parameters of the particle filter
+ */
+struct particle_filter_config_t
+{
+    size_t particles = 2000;
+    // worker threads for propagation and weighting (0 = one per core)
+    size_t threads = 0;
+    // odometry noise: standard deviation per cm driven and per radian turned
+    double distance_noise = 0.05;
+    double rotation_noise = 0.1;
+    // additional rotation noise per cm driven
+    double drift_noise = 0.005;
+    // resample once the effective sample size drops below this fraction
+    double resample_threshold = 0.5;
+    uint32_t seed = 1;
+};
+
+class ParticleFilter
+{
+    const FieldMap &map;
+    particle_filter_config_t config;
+    std::vector<range_sensor_t> range_sensors;
+    std::vector<line_sensor_t> line_sensors;
+
+    // particle state (structure of arrays)
+    std::vector<double> xs;
+    std::vector<double> ys;
+    std::vector<double> thetas;
+    std::vector<double> log_weights;
+    std::vector<double> weights;
+
+    // resampling buffers, preallocated to avoid allocations in updates
+    std::vector<double> next_xs;
+    std::vector<double> next_ys;
+    std::vector<double> next_thetas;
+
+    // worker pool. Every worker owns a fixed chunk of particles and a random
+    // generator, so results only depend on the seed and the thread count.
+    std::vector<std::thread> workers;
+    std::vector<std::mt19937> generators;
+    std::mutex pool_guard;
+    std::condition_variable pool_cv;
+    std::condition_variable done_cv;
+    std::function<void(size_t, size_t, size_t)> job;
+    uint64_t job_generation = 0;
+    size_t jobs_pending = 0;
+    bool exiting = false;
+
+    void workerFn(size_t worker);
+
+    /**
+     * @brief runs fn(worker, first, last) for every chunk of particles
+     * in parallel and blocks until all are done
+     */
+    void runParallel(std::function<void(size_t, size_t, size_t)> fn);
+
+    void chunk(size_t worker, size_t &first, size_t &last) const;
+
+    void resample();
+
+public:
+    ParticleFilter(const FieldMap &map, particle_filter_config_t config = particle_filter_config_t());
+    ~ParticleFilter();
+    ParticleFilter(const ParticleFilter &) = delete;
+    ParticleFilter &operator=(const ParticleFilter &) = delete;
+
+    void addRangeSensor(const range_sensor_t &sensor);
+    void addLineSensor(const line_sensor_t &sensor);
+
+    /**
+     * @brief distributes the particles around a pose
+     *
+     * @param pose initial pose
+     * @param position_spread standard deviation of the position in cm
+     * @param rotation_spread standard deviation of the rotation in radians
+     */
+    void reset(const pose_t &pose, double position_spread, double rotation_spread);
+
+    /**
+     * @brief moves all particles by an odometry step given in the robot frame
+     *
+     * @param forward distance driven forward in cm
+     * @param lateral distance moved to the left in cm (usually 0)
+     * @param rotation rotation in radians
+     */
+    void predict(double forward, double lateral, double rotation);
+
+    /**
+     * @brief weights the particles by how well they explain the observation
+     * and resamples if the weights have degenerated
+     *
+     * @param observation sensor readings
+     * @retval ok - particles weighted
+     * @retval err - observation doesn't match the configured sensors
+     */
+    el::retcode update(const observation_t &observation);
+
+    /**
+     * @return pose_t weighted mean pose of all particles
+     */
+    pose_t estimate() const;
+
+    /**
+     * @return double effective sample size as a fraction of the particle count
+     */
+    double effectiveSampleSize() const;
+
+    size_t size() const { return xs.size(); }
+    size_t threadCount() const { return workers.size() + 1; }
+};
+
+/**
+ * @brief generates sensor readings from a known (ground truth) pose.
+ * Used to run the localization off the robot.
+ */
+class SimulatedSensors
+{
+    const FieldMap &map;
+    std::vector<range_sensor_t> range_sensors;
+    std::vector<line_sensor_t> line_sensors;
+    std::mt19937 generator;
+
+public:
+    SimulatedSensors(const FieldMap &map, uint32_t seed = 1);
+
+    void addRangeSensor(const range_sensor_t &sensor);
+    void addLineSensor(const line_sensor_t &sensor);
+
+    /**
+     * @brief simulates readings of all sensors with noise
+     *
+     * @param pose true pose of the robot
+     */
+    observation_t observe(const pose_t &pose);
+};
+
+/**
+ * @brief connects a particle filter to a Navigation. Every update feeds
+ * the odometry change of the navigation into the filter, weights it with
+ * new sensor readings and writes the estimated pose back to the navigation.
+ */
+class Localizer
+{
+    Navigation &nav;
+    ParticleFilter &filter;
+    std::function<observation_t()> sensors;
+
+    // odometry pose of the navigation after the previous update
+    pose_t last_pose;
+
+    std::mutex update_guard;
+    std::atomic<int64_t> last_update_ns{0};
+
+    std::atomic_bool threxit{false};
+    std::thread thread;
+
+public:
+    /**
+     * @param nav navigation to correct
+     * @param filter filter with sensors configured, reset to the start pose
+     * @param sensors function returning the current sensor readings
+     */
+    Localizer(Navigation &nav, ParticleFilter &filter, std::function<observation_t()> sensors);
+    ~Localizer();
+
+    /**
+     * @brief runs one localization step and corrects the navigation pose
+     * (unless a spline command is running, which follows its own schedule)
+     *
+     * @retval ok - localization step done
+     * @retval err - observation invalid
+     */
+    el::retcode update();
+
+    /**
+     * @brief runs update() periodically on its own thread using the clock
+     * of the navigation
+     *
+     * @param period_ms update period
+     */
+    el::retcode start(int period_ms);
+
+    /**
+     * @brief stops the update thread
+     */
+    void stop();
+
+    /**
+     * @return int64_t real (CPU) time the last update took in ns,
+     * to check it fits the control period
+     */
+    int64_t getLastUpdateDuration() const { return last_update_ns; }
+};
@@ -11,11 +11,15 @@
  */
 
 #include <iostream>
-#include <kipr/time/time.h>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
 #include "navigation.hpp"
 
 #define WAIT_DELAY 50 // ms
 #define UPDATE_DELAY 2 // ms
+// spline waypoints closer than this to the start pose are already reached
+#define SPLINE_MIN_DISTANCE 0.01 // cm
 
 void noimpl()
 {
@@ -34,46 +38,377 @@ double normalizeAngle(double a)
     return a - (int)(a / (2 * M_PI)) * 2 * M_PI;
 }
 
+void Navigation::awaitNextCycle()
+{
+    const int64_t period_ns = (int64_t)UPDATE_DELAY * 1000000;
+    int64_t now = clock->now();
+
+    // If the loop fell behind by more than a period (idle waits, command
+    // timeouts), restart the schedule instead of catching up.
+    next_cycle_ns += period_ns;
+    if (next_cycle_ns < now - period_ns)
+        next_cycle_ns = now + period_ns;
+
+    clock->sleepUntil(next_cycle_ns);
+    loop_jitter.addSample(clock->now() - next_cycle_ns);
+}
+
+void Navigation::dispatchActions(bool motion_done)
+{
+    // actions at the front of the queue don't wait for the active target
+    while (!command_queue.empty() && command_queue.front().type == seq_cmd_t::action)
+    {
+        auto command = std::move(command_queue.front());
+        command_queue.pop();
+        if (command.start_percent <= 0 || active_command_type < 0)
+            action_lanes.submit(command.lane, command.action_id, std::move(command.fn));
+        else
+            triggered_actions.push_back(std::move(command));
+    }
+
+    if (triggered_actions.empty())
+        return;
+
+    double percent = motion_done ? 100 : activeCommandProgress() * 100;
+    for (auto it = triggered_actions.begin(); it != triggered_actions.end();)
+    {
+        if (percent >= it->start_percent)
+        {
+            action_lanes.submit(it->lane, it->action_id, std::move(it->fn));
+            it = triggered_actions.erase(it);
+        }
+        else
+            it++;
+    }
+}
+
+pose_t Navigation::commandPoseAt(double progress)
+{
+    pose_t pose = {current_position, current_rotation};
+    switch (active_command_type)
+    {
+    case seq_cmd_t::drive:
+        pose.position = command_start_position;
+        pose.position += el::polar_t(command_start_rotation, active_command_value * progress);
+        pose.rotation = command_start_rotation;
+        break;
+    case seq_cmd_t::turn:
+        pose.position = command_start_position;
+        pose.rotation = command_start_rotation + active_command_value * progress;
+        break;
+    case seq_cmd_t::arc:
+        pose = arcEndPose({command_start_position, command_start_rotation}, active_command_radius, active_command_value * progress);
+        break;
+    case seq_cmd_t::spline:
+        // the scheduled pose is where the robot should be, the encoders tell where it is
+        if (trajectory_odometry_valid)
+            pose = trajectory_odometry;
+        break;
+    default:
+        break;
+    }
+    return pose;
+}
+
+void Navigation::abortActiveCommand()
+{
+    // read the progress before the motors are stopped
+    double progress = getTargetProgress();
+    if (active_command_type == seq_cmd_t::spline)
+        updateTrajectoryOdometry();
+    rawStop();
+
+    pose_t pose = commandPoseAt(progress);
+    current_position = pose.position;
+    current_rotation = pose.rotation;
+    if (active_command_type == seq_cmd_t::spline)
+    {
+        active_trajectory = Trajectory();
+        trajectory_odometry_valid = false;
+    }
+    active_command_until = nullptr;
+}
+
+bool Navigation::checkStall()
+{
+    if (!stall_detector.getConfig().enabled)
+        return false;
+    wheel_state_t state;
+    if (getWheelState(state) != el::retcode::ok)
+        return false;
+    stall_event_t event;
+    if (!stall_detector.addSample(clock->now(), state, event))
+        return false;
+    // the wheels may still report the stall until the next command starts
+    stall_detector.disarm();
+
+    event.command_type = active_command_type;
+    event.command_value = active_command_value;
+    event.progress = activeCommandProgress();
+    abortActiveCommand();
+    event.position = current_position;
+    event.rotation = current_rotation;
+
+    if (stall_detector.getConfig().skip_remaining)
+    {
+        // keep the user actions so nothing waits for them forever
+        std::queue<seq_cmd_t> remaining;
+        for (; !command_queue.empty(); command_queue.pop())
+        {
+            auto &command = command_queue.front();
+            if (command.type == seq_cmd_t::action || command.type == seq_cmd_t::await_action)
+                remaining.push(std::move(command));
+        }
+        command_queue.swap(remaining);
+    }
+
+    last_stall = event;
+    stall_count++;
+    if (stall_handler)
+        stall_handler(event);
+    return true;
+}
+
+el::retcode Navigation::startTrajectory(const seq_cmd_t &command)
+{
+    std::vector<pose_t> waypoints;
+    waypoints.push_back({current_position, current_rotation});
+    for (const auto &waypoint : command.waypoints)
+    {
+        el::vec2_t offset = waypoint.position - waypoints.back().position;
+        if (waypoints.size() == 1 && offset.get_r() < SPLINE_MIN_DISTANCE)
+            continue;
+        waypoints.push_back(waypoint);
+    }
+    if (waypoints.size() < 2)
+        return el::retcode::err;
+
+    // the robot limits apply to unset limits and can't be exceeded
+    trajectory_limits_t limits = command.limits;
+    double max_velocity = getMaxWheelSpeed();
+    double max_acceleration = getMaxWheelAcceleration();
+    limits.wheel_velocity = limits.wheel_velocity > 0 ? std::min(limits.wheel_velocity, max_velocity) : max_velocity;
+    limits.wheel_acceleration = limits.wheel_acceleration > 0 ? std::min(limits.wheel_acceleration, max_acceleration) : max_acceleration;
+    limits.wheel_to_center = getWheelToCenter();
+    if (active_trajectory.generate(waypoints, limits) != el::retcode::ok)
+        return el::retcode::err;
+
+    trajectory_start_ns = clock->now();
+    trajectory_odometry = waypoints.front();
+    trajectory_odometry_valid = getWheelState(trajectory_wheels) == el::retcode::ok;
+    return el::retcode::ok;
+}
+
+void Navigation::updateTrajectoryOdometry()
+{
+    wheel_state_t state;
+    if (!trajectory_odometry_valid || getWheelState(state) != el::retcode::ok)
+        return;
+    double left = state.left_distance - trajectory_wheels.left_distance;
+    double right = state.right_distance - trajectory_wheels.right_distance;
+    trajectory_wheels = state;
+
+    double distance = (left + right) / 2;
+    double angle = (right - left) / (2 * getWheelToCenter());
+    // move along the average heading of the step
+    trajectory_odometry.position += el::polar_t(trajectory_odometry.rotation + angle / 2, distance);
+    trajectory_odometry.rotation += angle;
+}
+
+bool Navigation::updateTrajectory()
+{
+    // the pose and the trajectory are read by other threads
+    std::lock_guard lock(command_queue_guard);
+    if (active_trajectory.getSamples().empty())
+        return false;
+    
+    double t = (clock->now() - trajectory_start_ns) / 1e9;
+    if (t >= active_trajectory.duration())
+    {
+        rawStop();
+        const auto &end = active_trajectory.getSamples().back().pose;
+        current_position = end.position;
+        current_rotation = end.rotation;
+        active_trajectory = Trajectory();
+        trajectory_odometry_valid = false;
+        return false;
+    }
+
+    auto sample = active_trajectory.sampleAt(t);
+    rawDriveSpeeds(sample.left_speed, sample.right_speed);
+    current_position = sample.pose.position;
+    current_rotation = sample.pose.rotation;
+    updateTrajectoryOdometry();
+    dispatchActions(false);
+    if (active_command_until && active_command_until())
+    {
+        abortActiveCommand();
+        return false;
+    }
+    return !checkStall();
+}
+
+double Navigation::activeCommandProgress()
+{
+    if (active_command_type == seq_cmd_t::spline)
+    {
+        double duration = active_trajectory.duration();
+        if (duration <= 0)
+            return 1;
+        return std::min(1.0, (clock->now() - trajectory_start_ns) / 1e9 / duration);
+    }
+    return getTargetProgress();
+}
+
+pose_t Navigation::arcEndPose(const pose_t &start, double radius, double angle)
+{
+    // distance travelled by the robot center, negative backward
+    double distance = radius * std::abs(angle);
+    if (angle == 0)
+        return start;
+    
+    // signed distance from the robot to the arc center (positive is left)
+    double r = distance / angle;
+    el::vec2_t center = start.position;
+    center += el::polar_t(start.rotation + M_PI / 2, r);
+    pose_t end;
+    end.rotation = start.rotation + angle;
+    end.position = center;
+    end.position += el::polar_t(end.rotation - M_PI / 2, r);
+    return end;
+}
+
+void Navigation::moveAlongArc(double radius, double angle)
+{
+    pose_t end = arcEndPose({current_position, current_rotation}, radius, angle);
+    current_position = end.position;
+    current_rotation = end.rotation;
+}
+
 void Navigation::sequenceThreadFn()
 {
+    // time may only advance while this thread sleeps. Until now,
+    // initialize() has held the clock for it.
+    clock->attach();
+    clock->release();
+
     bool first_command = true;
     while (!threxit)
     {
+        publishTelemetry();
+
         // wait until the sequence is marked incomplete
         if (sequence_complete)
         {
-            msleep(WAIT_DELAY);
+            waitForSequenceStart();
             continue;
         }
         
+        // execute the active trajectory
+        if (active_command_type == seq_cmd_t::spline && updateTrajectory())
+        {
+            awaitNextCycle();
+            continue;
+        }
+
         // await the active target completion
         if (!targetReached())
         {
-            msleep(UPDATE_DELAY);
+            {
+                std::lock_guard lock(command_queue_guard);
+                dispatchActions(false);
+                if (active_command_until && active_command_until())
+                    abortActiveCommand();
+                else
+                    checkStall();
+            }
+            awaitNextCycle();
             continue;
         }
         
         std::unique_lock lock(command_queue_guard);
+        // the active command (if any) has reached its target
+        if (active_command_type >= 0)
+        {
+            active_command_type = -1;
+            active_command_until = nullptr;
+            commands_completed++;
+        }
+        dispatchActions(true);
+
         // if the queue is empty, mark the sequence as complete
         if (command_queue.empty())
         {
+            // user actions of this sequence might still be running
+            if (!action_lanes.idle())
+            {
+                lock.unlock();
+                awaitNextCycle();
+                continue;
+            }
+            lock.unlock();
             // timeout for the last command
-            msleep(getCommandTimeout());
+            if (!first_command)
+            {
+                clock->sleepMs(getCommandTimeout());
+                // commands added during the timeout continue the sequence
+                // (without waiting for the timeout again)
+                lock.lock();
+                if (!command_queue.empty())
+                {
+                    first_command = true;
+                    continue;
+                }
+            }
+            else
+                lock.lock();
             sequence_complete = true;
             first_command = true;
-            lock.unlock();
+            // the waiting threads continue before any time passes
+            for (; sequence_waiters > 0; sequence_waiters--)
+            {
+                clock->hold();
+                sequence_waiter_holds++;
+            }
+            sequence_done_cv.notify_all();
             continue;
         }
 
         // read and execute the next command
         auto command = command_queue.front();
 
+        // hold back everything after a dependency until the action is done
+        if (command.type == seq_cmd_t::await_action)
+        {
+            if (action_lanes.isDone(command.action_id))
+                command_queue.pop();
+            lock.unlock();
+            awaitNextCycle();
+            continue;
+        }
+
+        // skip conditional commands whose condition is already met
+        if (command.until && command.until())
+        {
+            command_queue.pop();
+            commands_completed++;
+            continue;
+        }
+
         // don't wait before the first command
         if (first_command)
             first_command = false;
         else
-            msleep(getCommandTimeout());
+        {
+            // don't block the queue while waiting
+            lock.unlock();
+            clock->sleepMs(getCommandTimeout());
+            lock.lock();
+        }
 
+        command_start_position = current_position;
+        command_start_rotation = current_rotation;
+        stall_detector.reset(clock->now());
         switch (command.type)
         {
         case seq_cmd_t::drive:
@@ -82,27 +417,174 @@ void Navigation::sequenceThreadFn()
         case seq_cmd_t::turn:
             rawRotateBy(command.value);
             break;
+        case seq_cmd_t::arc:
+            rawDriveArc(command.radius, command.value);
+            break;
+        case seq_cmd_t::spline:
+            if (startTrajectory(command) != el::retcode::ok)
+            {
+                // the robot hasn't moved, report the command instead of completing it
+                commands_failed++;
+                if (command.failed)
+                    command.failed();
+                command_queue.pop();
+                continue;
+            }
+            break;
         default:
             break;
         }
+        active_command_type = command.type;
+        active_command_value = command.value;
+        active_command_radius = command.radius;
+        active_command_until = command.until;
         // remove the command from the queue
         command_queue.pop();
     }
+
+    clock->detach();
+}
+
+void Navigation::waitForSequenceStart()
+{
+    std::unique_lock lock(command_queue_guard);
+    // started in the meantime, stay attached
+    if (threxit || !sequence_complete)
+        return;
+    clock->detach();
+    sequence_idle = true;
+
+    while (!threxit && sequence_complete)
+    {
+        // telemetry keeps being published in real time while idle
+        sequence_start_cv.wait_for(lock, std::chrono::milliseconds(WAIT_DELAY));
+        lock.unlock();
+        publishTelemetry();
+        lock.lock();
+    }
+
+    clock->attach();
+    sequence_idle = false;
+    if (sequence_start_held)
+    {
+        sequence_start_held = false;
+        clock->release();
+    }
+}
+
+void Navigation::publishTelemetry()
+{
+    if (!telemetry_enabled)
+        return;
+
+    // The pose and the queue are also changed by other threads. Never wait
+    // for them: while the queue lock is held, the values of the previous cycle are published.
+    std::unique_lock lock(command_queue_guard, std::try_to_lock);
+    if (lock.owns_lock())
+    {
+        telemetry_snapshot.x = current_position.x;
+        telemetry_snapshot.y = current_position.y;
+        telemetry_snapshot.rotation = current_rotation;
+        telemetry_snapshot.queue_depth = command_queue.size();
+        lock.unlock();
+    }
+
+    // the remaining fields are only changed by the sequence thread itself
+    telemetry_data_t data = telemetry_snapshot;
+    data.sequence_complete = sequence_complete;
+    data.command_type = active_command_type;
+    data.command_value = active_command_value;
+    data.commands_completed = commands_completed;
+    uint64_t total = data.commands_completed + data.queue_depth + (active_command_type >= 0 ? 1 : 0);
+    data.sequence_progress = total ? (double)data.commands_completed / total : 1;
+    data.stall_count = stall_count;
+
+    telemetry->publish(data);
 }
 
 el::retcode Navigation::initialize()
 {
+    // no time may pass before the sequence thread is attached to the clock
+    clock->hold();
     sequence_thread = std::thread(&Navigation::sequenceThreadFn, this);
+    if (rt_configured)
+        rt_status = applyRealtimeConfig(sequence_thread.native_handle(), rt_config);
     return el::retcode::ok;
 }
 el::retcode Navigation::terminate()
 {
-    threxit = true;
+    {
+        std::lock_guard lock(command_queue_guard);
+        threxit = true;
+        sequence_start_cv.notify_all();
+        sequence_done_cv.notify_all();
+    }
+    // a thread attached to a virtual clock has to let time advance
+    // so the sequence thread can wake up and exit
+    bool attached = clock->detach();
     if (sequence_thread.joinable())
         sequence_thread.join();
+    if (attached)
+        clock->attach();
+    action_lanes.shutdown();
+    return el::retcode::ok;
+}
+
+el::retcode Navigation::setClock(std::shared_ptr<Clock> _clock)
+{
+    if (sequence_thread.joinable() || !_clock)
+        return el::retcode::err;
+    clock = _clock;
+    action_lanes.setClock(clock);
+    return el::retcode::ok;
+}
+
+std::shared_ptr<Clock> Navigation::getClock() const
+{
+    return clock;
+}
+
+el::retcode Navigation::enableTelemetry(const char *name)
+{
+    std::lock_guard lock(command_queue_guard);
+    if (telemetry_enabled)
+        return el::retcode::err;
+
+    auto publisher = std::make_unique<TelemetryPublisher>();
+    if (publisher->open(name) != el::retcode::ok)
+        return el::retcode::err;
+    telemetry = std::move(publisher);
+    telemetry_enabled = true;
     return el::retcode::ok;
 }
 
+el::retcode Navigation::setRealtimeConfig(const rt_config_t &config)
+{
+    if (validateRealtimeConfig(config) != el::retcode::ok)
+        return el::retcode::err;
+    rt_config = config;
+    rt_configured = true;
+    if (!sequence_thread.joinable())
+        return el::retcode::ok;
+    rt_status = applyRealtimeConfig(sequence_thread.native_handle(), rt_config);
+    return rt_status;
+}
+
+el::retcode Navigation::getRealtimeStatus() const
+{
+    return rt_status;
+}
+
+jitter_stats_t Navigation::getLoopJitter() const
+{
+    return loop_jitter.getStats();
+}
+
+void Navigation::resetLoopJitter()
+{
+    loop_jitter.reset();
+}
+
 const el::vec2_t &Navigation::getCurrentPosition() const
 {
     return current_position;
@@ -128,6 +610,41 @@ void Navigation::setCurrentRotation(double angle)
     current_rotation = angle;
 }
 
+pose_t Navigation::getOdometryPose()
+{
+    std::lock_guard lock(command_queue_guard);
+    if (active_command_type < 0)
+        return {current_position, current_rotation};
+    return commandPoseAt(getTargetProgress());
+}
+
+el::retcode Navigation::correctPose(const pose_t &odometry, const pose_t &corrected)
+{
+    std::lock_guard lock(command_queue_guard);
+    // the pose of a running trajectory is overwritten every cycle
+    if (active_command_type == seq_cmd_t::spline)
+        return el::retcode::nak;
+
+    // move the kept pose and the start pose of the active command
+    // rigidly so the odometry pose ends up on the corrected one
+    double angle = corrected.rotation - odometry.rotation;
+    double c = std::cos(angle);
+    double s = std::sin(angle);
+    auto transform = [&](el::vec2_t &position, double &rotation)
+    {
+        double dx = position.x - odometry.position.x;
+        double dy = position.y - odometry.position.y;
+        position = el::vec2_t(
+            corrected.position.x + c * dx - s * dy,
+            corrected.position.y + s * dx + c * dy
+        );
+        rotation += angle;
+    };
+    transform(current_position, current_rotation);
+    transform(command_start_position, command_start_rotation);
+    return el::retcode::ok;
+}
+
 el::retcode Navigation::rotateBy(double angle)
 {
     std::lock_guard lock(command_queue_guard);
@@ -168,6 +685,86 @@ el::retcode Navigation::driveDistance(double distance)
     return el::retcode::ok;
 }
 
+el::retcode Navigation::rotateByUntil(double angle, std::function<bool()> condition)
+{
+    std::lock_guard lock(command_queue_guard);
+    seq_cmd_t command;
+    command.type = seq_cmd_t::turn;
+    command.value = angle;
+    command.until = std::move(condition);
+    command_queue.push(command);
+    return el::retcode::ok;
+}
+
+el::retcode Navigation::driveDistanceUntil(double distance, std::function<bool()> condition)
+{
+    std::lock_guard lock(command_queue_guard);
+    seq_cmd_t command;
+    command.type = seq_cmd_t::drive;
+    command.value = distance;
+    command.until = std::move(condition);
+    command_queue.push(command);
+    return el::retcode::ok;
+}
+
+el::retcode Navigation::driveArc(double radius, double angle)
+{
+    std::lock_guard lock(command_queue_guard);
+    seq_cmd_t command;
+    command.type = seq_cmd_t::arc;
+    command.value = angle;
+    command.radius = radius;
+    command_queue.push(command);
+    return el::retcode::ok;
+}
+
+// like driveToPosition(), this uses the current position and not the one at the end of the queue
+el::retcode Navigation::driveArcTo(el::vec2_t pos, bool bw)
+{
+    // target relative to the robot (x forward, y left). When driving
+    // backward, the arc is calculated for the robot facing backward.
+    double heading = current_rotation + (bw ? M_PI : 0);
+    el::vec2_t delta = pos - current_position;
+    double x = delta.x * std::cos(heading) + delta.y * std::sin(heading);
+    double y = -delta.x * std::sin(heading) + delta.y * std::cos(heading);
+
+    if (std::abs(y) < 1e-6)
+        return driveDistance(x * (bw ? -1 : 1));
+
+    // the circle tangential to the heading through the target has its center
+    // on the y axis. The heading changes by twice the angle of the chord.
+    double radius = (x * x + y * y) / (2 * std::abs(y));
+    double angle = 2 * std::atan2(y, x);
+    return driveArc(bw ? -radius : radius, angle);
+}
+
+el::retcode Navigation::driveSpline(const std::vector<pose_t> &waypoints, trajectory_limits_t limits, std::function<void()> failed)
+{
+    if (waypoints.empty())
+        return el::retcode::err;
+    // 0 selects the robot limit
+    if (!std::isfinite(limits.wheel_velocity) || limits.wheel_velocity < 0
+        || !std::isfinite(limits.wheel_acceleration) || limits.wheel_acceleration < 0)
+        return el::retcode::err;
+    for (size_t i = 0; i < waypoints.size(); i++)
+    {
+        const auto &waypoint = waypoints[i];
+        if (!std::isfinite(waypoint.position.x) || !std::isfinite(waypoint.position.y) || !std::isfinite(waypoint.rotation))
+            return el::retcode::err;
+        if (i > 0 && waypoint.position.x == waypoints[i - 1].position.x && waypoint.position.y == waypoints[i - 1].position.y)
+            return el::retcode::err;
+    }
+    
+    std::lock_guard lock(command_queue_guard);
+    seq_cmd_t command;
+    command.type = seq_cmd_t::spline;
+    command.waypoints = waypoints;
+    command.limits = limits;
+    command.failed = failed;
+    command_queue.push(command);
+    return el::retcode::ok;
+}
+
 el::retcode Navigation::driveVector(el::vec2_t d, bool bw)
 {
     rotateTo(d.get_phi() + (bw ? M_PI : 0));
@@ -183,6 +780,92 @@ el::retcode Navigation::driveToPosition(el::vec2_t pos, bool bw)
     return driveVector(delta, bw);
 }
 
+double Navigation::getTargetProgress()
+{
+    return targetReached() ? 1 : 0;
+}
+
+action_id_t Navigation::addAction(std::function<void()> action, int lane, int start_percent)
+{
+    std::lock_guard lock(command_queue_guard);
+    seq_cmd_t command;
+    command.type = seq_cmd_t::action;
+    command.fn = std::move(action);
+    command.action_id = action_lanes.create();
+    command.lane = lane;
+    command.start_percent = start_percent;
+    command_queue.push(command);
+    return command.action_id;
+}
+
+el::retcode Navigation::waitForAction(action_id_t id)
+{
+    std::lock_guard lock(command_queue_guard);
+    seq_cmd_t command;
+    command.type = seq_cmd_t::await_action;
+    command.action_id = id;
+    command_queue.push(command);
+    return el::retcode::ok;
+}
+
+bool Navigation::actionComplete(action_id_t id)
+{
+    return action_lanes.isDone(id);
+}
+
+el::retcode Navigation::awaitActionComplete(action_id_t id)
+{
+    action_lanes.awaitDone(id);
+    return el::retcode::ok;
+}
+
+el::retcode Navigation::setStallDetection(const stall_config_t &config)
+{
+    if (config.window_ms <= 0 || config.grace_ms < 0 || config.min_speed_ratio < 0 || config.max_speed_ratio <= config.min_speed_ratio)
+        return el::retcode::err;
+
+    std::lock_guard lock(command_queue_guard);
+    stall_detector.configure(config);
+    wheel_state_t state;
+    return getWheelState(state) == el::retcode::ok ? el::retcode::ok : el::retcode::nak;
+}
+
+void Navigation::setStallHandler(std::function<void(const stall_event_t &)> handler)
+{
+    std::lock_guard lock(command_queue_guard);
+    stall_handler = std::move(handler);
+}
+
+el::retcode Navigation::getLastStall(stall_event_t &event)
+{
+    std::lock_guard lock(command_queue_guard);
+    if (stall_count == 0)
+        return el::retcode::nak;
+    event = last_stall;
+    return el::retcode::ok;
+}
+
+uint64_t Navigation::getStallCount()
+{
+    std::lock_guard lock(command_queue_guard);
+    return stall_count;
+}
+
+uint64_t Navigation::getFailedCommandCount()
+{
+    return commands_failed;
+}
+
+el::retcode Navigation::getWheelState(wheel_state_t &)
+{
+    return el::retcode::nak;
+}
+
+std::unique_lock<std::recursive_mutex> Navigation::lockSequence()
+{
+    return std::unique_lock(command_queue_guard);
+}
+
 el::retcode Navigation::startSequence()
 {
     if (!sequence_complete)
@@ -193,7 +876,15 @@ el::retcode Navigation::startSequence()
         return el::retcode::nak;
 
     // start sequence processing
+    commands_completed = 0;
     sequence_complete = false;
+    // no time may pass until the idle sequence thread is attached to the clock again
+    if (sequence_idle && !sequence_start_held)
+    {
+        sequence_start_held = true;
+        clock->hold();
+    }
+    sequence_start_cv.notify_all();
     return el::retcode::ok;
 }
 
@@ -204,11 +895,29 @@ bool Navigation::sequenceComplete()
 
 el::retcode Navigation::awaitSequenceComplete()
 {
+    std::unique_lock lock(command_queue_guard);
     if (sequence_complete)
         return el::retcode::nak;
     
-    while (!sequence_complete)
-        msleep(UPDATE_DELAY);
-    
+    // time has to be able to advance while the sequence runs
+    bool attached = clock->detach();
+    if (attached)
+        sequence_waiters++;
+
+    sequence_done_cv.wait(lock, [&] { return threxit || sequence_complete; });
+
+    if (attached)
+    {
+        clock->attach();
+        if (sequence_waiter_holds > 0)
+        {
+            // hold taken by the sequence thread
+            sequence_waiter_holds--;
+            clock->release();
+        }
+        else
+            // terminated before the sequence completed
+            sequence_waiters--;
+    }
     return el::retcode::ok;
 }
\ No newline at end of file
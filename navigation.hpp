@@ -16,8 +16,18 @@
 #include <atomic>
 #include <thread>
 #include <mutex>
+#include <memory>
+#include <vector>
+#include <functional>
+#include <condition_variable>
 #include <el/retcode.hpp>
 #include <el/vec.hpp>
+#include "telemetry.hpp"
+#include "realtime.hpp"
+#include "action_lanes.hpp"
+#include "clock.hpp"
+#include "trajectory.hpp"
+#include "stall_detector.hpp"
 
 class Navigation
 {
@@ -26,26 +36,210 @@ protected:
     double current_rotation = 0;
     int configured_speed = 500;
 
+    // time source for all waits and timeouts
+    std::shared_ptr<Clock> clock = Clock::system();
+
     struct seq_cmd_t
     {
         // command type
         enum cmd_type_t
         {
             drive,
-            turn
+            turn,
+            arc,            // value is the angle, radius the arc radius
+            spline,         // trajectory through waypoints
+            action,         // start a user action on a lane
+            await_action    // wait until a user action has completed
         } type;
         // distance or angle to drive
-        double value;
+        double value = 0;
+        // radius of arc commands
+        double radius = 0;
+        // waypoints and limits of spline commands
+        std::vector<pose_t> waypoints;
+        trajectory_limits_t limits;
+        // called instead of completing a spline command whose trajectory can't be generated
+        std::function<void()> failed;
+        // optional condition that ends a drive or turn command early
+        std::function<bool()> until;
+
+        // user action parameters
+        std::function<void()> fn;
+        action_id_t action_id = -1;
+        int lane = 0;
+        // percentage of the preceding motion command at which the action starts
+        int start_percent = 0;
     };
 
-    std::mutex command_queue_guard;
+    // recursive so a batch of commands can be added under one lock (see lockSequence())
+    std::recursive_mutex command_queue_guard;
     std::queue<seq_cmd_t> command_queue;
-    std::atomic_bool sequence_complete{false};
+    // there is no sequence until startSequence() is called
+    std::atomic_bool sequence_complete{true};
+
+    // executor for user actions and the actions waiting for
+    // the active motion command to reach their start percentage
+    ActionLanes action_lanes;
+    std::vector<seq_cmd_t> triggered_actions;
+
+    /**
+     * @brief starts the user actions at the front of the queue and any
+     * triggered actions whose start percentage has been reached.
+     * Has to be called with the command queue locked.
+     * 
+     * @param motion_done true if the active motion command has reached its target
+     */
+    void dispatchActions(bool motion_done);
+
+    // type of the command currently executing (-1 if none) and its value
+    int active_command_type = -1;
+    double active_command_value = 0;
+    double active_command_radius = 0;
+    // stop condition of the active command (empty if none)
+    std::function<bool()> active_command_until;
+    // pose at the start of the active command
+    el::vec2_t command_start_position;
+    double command_start_rotation = 0;
+
+    /**
+     * @brief calculates the pose after a fraction of the active command.
+     * Has to be called with the command queue locked.
+     * 
+     * @param progress progress of the active command from 0 to 1
+     * @return pose_t pose at that progress (the encoder pose of a spline, the kept
+     * pose if no command is active)
+     */
+    pose_t commandPoseAt(double progress);
+
+    /**
+     * @brief stops the active motion command before it reaches its target
+     * and corrects the pose to the distance or angle that has actually been
+     * travelled according to the motor encoders.
+     */
+    void abortActiveCommand();
+
+    // wheel speed schedule of the active spline command
+    Trajectory active_trajectory;
+    int64_t trajectory_start_ns = 0;
+    // pose integrated from the wheel encoders while the spline is driven (if
+    // the robot reports them), used when the spline is aborted
+    bool trajectory_odometry_valid = false;
+    pose_t trajectory_odometry;
+    wheel_state_t trajectory_wheels;
+
+    /**
+     * @brief moves the encoder pose of the active spline by the wheel travel
+     * since the last call. Has to be called with the command queue locked.
+     */
+    void updateTrajectoryOdometry();
+
+    /**
+     * @brief generates the trajectory of a spline command from the current
+     * pose and starts executing it
+     * 
+     * @retval ok - trajectory started
+     * @retval err - trajectory could not be generated
+     */
+    el::retcode startTrajectory(const seq_cmd_t &command);
 
-    std::atomic_bool threxit;
+    /**
+     * @brief sends the scheduled wheel speeds of the active trajectory to
+     * the robot and updates the pose. Called every control cycle while a spline
+     * command is active.
+     * 
+     * @retval true - trajectory still running
+     * @retval false - trajectory completed
+     */
+    bool updateTrajectory();
+
+    /**
+     * @return double progress of the active command from 0 to 1
+     */
+    double activeCommandProgress();
+
+    /**
+     * @brief calculates the pose at the end of a circular arc
+     * 
+     * @param start pose at the start of the arc
+     * @param radius arc radius in cm, negative when driving backward
+     * @param angle heading change in radians, positive is ccw
+     * @return pose_t pose at the end of the arc
+     */
+    static pose_t arcEndPose(const pose_t &start, double radius, double angle);
+
+    /**
+     * @brief moves the internally kept pose along a circular arc
+     * 
+     * @param radius arc radius in cm, negative when driving backward
+     * @param angle heading change in radians, positive is ccw
+     */
+    void moveAlongArc(double radius, double angle);
+    // number of commands completed in the current sequence
+    std::atomic<uint64_t> commands_completed{0};
+    // number of commands that couldn't be started since initialization
+    std::atomic<uint64_t> commands_failed{0};
+
+    // stall and slip detection of the active command
+    StallDetector stall_detector;
+    std::function<void(const stall_event_t &)> stall_handler;
+    stall_event_t last_stall;
+    uint64_t stall_count = 0;
+
+    /**
+     * @brief feeds the wheel state into the stall detector and aborts the
+     * active command if the robot is stuck. Has to be called with the command queue locked.
+     * 
+     * @retval true - a stall was detected and the command aborted
+     */
+    bool checkStall();
+
+    // shared memory telemetry, only created if enabled. It is never
+    // replaced once enabled, so the sequence thread can use it without locking.
+    std::unique_ptr<TelemetryPublisher> telemetry;
+    std::atomic_bool telemetry_enabled{false};
+    // pose and queue depth published while another thread holds the queue lock
+    telemetry_data_t telemetry_snapshot = {};
+    void publishTelemetry();
+
+    std::atomic_bool threxit{false};
     std::thread sequence_thread;
     void sequenceThreadFn();
 
+    // signalled by startSequence() and terminate() while the sequence thread is idle
+    std::condition_variable_any sequence_start_cv;
+    // the idle sequence thread is detached from the clock. Set with the queue locked.
+    bool sequence_idle = false;
+    // startSequence() holds the clock until the sequence thread is attached again
+    bool sequence_start_held = false;
+    // signalled when the sequence completes and by terminate()
+    std::condition_variable_any sequence_done_cv;
+    // clock participants detached in awaitSequenceComplete(). When the sequence
+    // completes, the sequence thread takes a hold for each of them.
+    int sequence_waiters = 0;
+    int sequence_waiter_holds = 0;
+
+    /**
+     * @brief blocks the sequence thread until the sequence is started or
+     * the navigation terminates. The thread leaves the clock participants
+     * meanwhile, so an idle navigation doesn't move a virtual clock forward.
+     */
+    void waitForSequenceStart();
+
+    // scheduling of the sequence thread and its wakeup statistics
+    rt_config_t rt_config;
+    bool rt_configured = false;
+    // result of the last attempt to apply rt_config to the sequence thread
+    el::retcode rt_status = el::retcode::ok;
+    JitterMonitor loop_jitter;
+    // absolute deadline of the next control cycle (clock time, ns)
+    int64_t next_cycle_ns = 0;
+
+    /**
+     * @brief sleeps until the next control cycle deadline. The deadlines
+     * are absolute so the period doesn't drift with the loop execution time.
+     */
+    void awaitNextCycle();
+
     
     // This is the time waited after every command (even the last one)
     // to ensure the PID controller has reached the target.
@@ -56,6 +250,69 @@ public:
     virtual el::retcode initialize();
     virtual el::retcode terminate();
 
+    /**
+     * @brief replaces the clock used for all waits and timeouts of the sequence
+     * engine and the robot implementation, e.g. with a VirtualClock to run simulations
+     * faster than real time. Has to be called before initialize().
+     * 
+     * @param clock new time source
+     * @retval ok - clock replaced
+     * @retval err - already initialized or no clock provided
+     */
+    virtual el::retcode setClock(std::shared_ptr<Clock> clock);
+
+    /**
+     * @return std::shared_ptr<Clock> the clock used by the navigation
+     */
+    virtual std::shared_ptr<Clock> getClock() const;
+
+    /**
+     * @brief starts publishing the pose and sequence state to a POSIX
+     * shared memory object that other processes can read using a TelemetryReader.
+     * The state is updated from the sequence thread every control cycle.
+     * 
+     * @param name shared memory object name
+     * @retval ok - telemetry enabled
+     * @retval err - already enabled or shared memory object could not be created
+     */
+    virtual el::retcode enableTelemetry(const char *name = TELEMETRY_DEFAULT_NAME);
+
+    /**
+     * @brief configures the scheduling of the sequence (control) thread, e.g.
+     * to run it with SCHED_FIFO priority pinned to a core that doesn't do
+     * camera processing. Can be called before or after initialize().
+     * Options the process has no privileges for are skipped.
+     * An invalid configuration is rejected and not stored. When called
+     * before initialize(), the result of applying the configuration is
+     * available from getRealtimeStatus() once initialize() has run.
+     * 
+     * @param config scheduling configuration
+     * @retval ok - configuration applied (or stored until initialize())
+     * @retval nak - applied partially due to missing privileges
+     * @retval err - invalid configuration
+     */
+    virtual el::retcode setRealtimeConfig(const rt_config_t &config);
+
+    /**
+     * @brief result of the last attempt to apply the realtime configuration
+     * to the sequence thread
+     * 
+     * @retval ok - configuration applied or none configured
+     * @retval nak - applied partially due to missing privileges
+     */
+    virtual el::retcode getRealtimeStatus() const;
+
+    /**
+     * @return jitter_stats_t wakeup error statistics of the control loop
+     * since initialization or the last resetLoopJitter()
+     */
+    virtual jitter_stats_t getLoopJitter() const;
+
+    /**
+     * @brief clears the control loop wakeup statistics
+     */
+    virtual void resetLoopJitter();
+
     // === System state getters and setters === //
     virtual const el::vec2_t &getCurrentPosition() const;
     virtual double getCurrentRotation() const;
@@ -84,6 +341,27 @@ public:
      */
     virtual void setCurrentRotation(double angle);
 
+    /**
+     * @brief calculates the pose the robot is in right now according to the
+     * wheel encoders. Unlike getCurrentPosition(), which already is the target
+     * of the active command, this is updated while the robot moves.
+     * 
+     * @return pose_t current odometry pose
+     */
+    virtual pose_t getOdometryPose();
+
+    /**
+     * @brief corrects the internally kept pose using an externally measured one
+     * (e.g. from localization). The kept pose and the active command are moved
+     * by the offset between the two, so a running command still ends in the right place.
+     * 
+     * @param odometry pose returned by getOdometryPose() at the time of the measurement
+     * @param corrected measured pose at that time
+     * @retval ok - pose corrected
+     * @retval nak - a spline command is active, pose not corrected
+     */
+    virtual el::retcode correctPose(const pose_t &odometry, const pose_t &corrected);
+
     /**
      * @brief starts a robot rotation command
      * This will not add a command to the sequence. This is the raw 
@@ -103,6 +381,54 @@ public:
      */
     virtual el::retcode rawDriveDistance(double distance) = 0;
 
+    /**
+     * @brief stops the active rotation or driving command where it currently
+     * is, so the target counts as reached. The caller is responsible for
+     * correcting the pose. This is the raw function used by the sequence processor
+     * to end commands early.
+     */
+    virtual el::retcode rawStop() = 0;
+
+    /**
+     * @brief starts driving along a circular arc by moving both wheels
+     * by different distances. This has to be implemented by specializations.
+     * This will not add a command to the sequence. This is the raw
+     * function used by the sequence processor
+     * 
+     * @param radius arc radius in cm (from the arc center to the robot center),
+     * negative to drive backward
+     * @param angle heading change in radians, positive is ccw
+     */
+    virtual el::retcode rawDriveArc(double radius, double angle) = 0;
+
+    /**
+     * @brief switches the motors to direct speed control (if not already done)
+     * and sets the speed of both wheels. rawStop() ends speed control and
+     * re-enables position control.
+     * This is the raw function used by the sequence processor to execute
+     * trajectories.
+     * 
+     * @param left left wheel speed in cm/s
+     * @param right right wheel speed in cm/s
+     */
+    virtual el::retcode rawDriveSpeeds(double left, double right) = 0;
+
+    /**
+     * @return double distance from a wheel to the center point of the robot in cm
+     */
+    virtual double getWheelToCenter() const = 0;
+
+    /**
+     * @return double fastest wheel speed in cm/s. This is the configured speed
+     * (see setMotorSpeed()) converted to cm/s, so both motors stay within it.
+     */
+    virtual double getMaxWheelSpeed() const = 0;
+
+    /**
+     * @return double fastest wheel acceleration in cm/s^2 the wheels follow without slipping
+     */
+    virtual double getMaxWheelAcceleration() const = 0;
+
     /**
      * @brief rotates the robot by a specific angle.
      * positive is ccw (mathematical angle)
@@ -134,6 +460,81 @@ public:
      */
     virtual el::retcode driveDistance(double distance);
 
+    /**
+     * @brief rotates the robot by a specific angle like rotateBy() but stops
+     * as soon as the condition returns true. The condition is evaluated
+     * by the sequence thread every control cycle while the rotation is active,
+     * so it has to be fast and must not block. If it is already true when the
+     * command is reached, the command is skipped.
+     * This will add a rotate sequence command to the queue.
+     * 
+     * @param angle the maximum angle in radians
+     * @param condition stop condition, e.g. a line sensor check
+     */
+    virtual el::retcode rotateByUntil(double angle, std::function<bool()> condition);
+
+    /**
+     * @brief drives the robot by a certain distance like driveDistance() but stops
+     * as soon as the condition returns true. The condition is evaluated
+     * by the sequence thread every control cycle while driving, so it has to be
+     * fast and must not block. If it is already true when the command is
+     * reached, the command is skipped. The pose is corrected to the distance
+     * actually driven.
+     * This will add a drive sequence command to the queue.
+     * 
+     * @param distance the maximum distance in cm
+     * @param condition stop condition, e.g. a bumper check
+     */
+    virtual el::retcode driveDistanceUntil(double distance, std::function<bool()> condition);
+
+    /**
+     * @brief drives along a circular arc in one smooth motion instead of
+     * rotating and driving straight. The robot starts tangential to the arc in its
+     * current direction and ends with its rotation changed by angle.
+     * A radius of 0 rotates in place.
+     * This will add an arc sequence command to the queue.
+     * 
+     * @param radius arc radius in cm, negative to drive backward
+     * @param angle heading change in radians, positive is ccw (left)
+     */
+    virtual el::retcode driveArc(double radius, double angle);
+
+    /**
+     * @brief drives along the circular arc that starts in the current direction
+     * of the robot and ends at an absolute position in the root coordinate system.
+     * The final rotation results from the arc. If the target is straight ahead,
+     * this is the same as driving straight. Targets behind the robot result in
+     * arcs of more than 180 degrees.
+     * This will add an arc sequence command to the queue.
+     * 
+     * @param pos absolute target position
+     * @param bw flag to tell to robot to drive backward instead of forwards
+     * @retval ok
+     */
+    virtual el::retcode driveArcTo(el::vec2_t pos, bool bw = false);
+
+    /**
+     * @brief drives along a smooth curve through a list of poses without
+     * stopping at them, e.g. to approach a station square-on without a final
+     * rotateTo(). When the command is reached, a spline trajectory from the
+     * then current pose through the waypoints is generated and executed with
+     * the fastest wheel speeds the limits allow.
+     * This will add a spline sequence command to the queue.
+     * 
+     * @param waypoints absolute poses to pass through, the last one is the target
+     * @param limits wheel speed and acceleration limits. Limits that are 0 or
+     * higher than the ones of the robot (getMaxWheelSpeed(), getMaxWheelAcceleration())
+     * are replaced by the robot limits. The robot geometry is filled in automatically.
+     * @param failed optional function called from the sequence thread if no
+     * trajectory can be generated from the pose the command is reached at (e.g. the
+     * curve reverses an odd number of times). The command is then skipped and
+     * counted by getFailedCommandCount() instead of completing.
+     * @retval ok - command added
+     * @retval err - no waypoints, two consecutive waypoints at the same position
+     * or invalid limits
+     */
+    virtual el::retcode driveSpline(const std::vector<pose_t> &waypoints, trajectory_limits_t limits = trajectory_limits_t(), std::function<void()> failed = nullptr);
+
     /**
      * @brief drives in a straight line by a specific vector relative to the current position 
      * that is referenced to the root coordinate system. When issued
@@ -175,8 +576,16 @@ public:
     virtual el::retcode awaitTargetReached() = 0;
 
     /**
-     * @brief (Not jet implemented for both tiramisu and croissant)
-     * blocks until the currently next sequence target is completed
+     * @brief returns how much of the active target has been completed.
+     * The default implementation only knows whether the target has been reached,
+     * robot implementations override this with the actual motor progress.
+     * 
+     * @return double progress from 0 to 1 (1 if no target active)
+     */
+    virtual double getTargetProgress();
+
+    /**
+     * @brief blocks until the currently next sequence target is completed
      * to a certain percentage. For example, if the target is driving 
      * forward two meters, awaitTargetPercentage(50) will block until 
      * one meter has been completed. If the requested percentage has
@@ -187,6 +596,106 @@ public:
      */
     virtual el::retcode awaitTargetPercentage(int percent) = 0;
 
+    /**
+     * @brief adds a user action (e.g. moving a servo or the arm) to the sequence.
+     * The action doesn't block the sequence, it runs on its own lane in parallel
+     * to the following motion commands. Actions on the same lane run one after
+     * another in the order they were added.
+     * 
+     * @param action callable to run
+     * @param lane lane to run the action on
+     * @param start_percent the action starts once the motion command queued before it
+     * has completed this percentage. 0 starts it together with that command,
+     * 100 once it has reached its target.
+     * @return action_id_t id that can be used to wait for the action
+     */
+    virtual action_id_t addAction(std::function<void()> action, int lane = 0, int start_percent = 0);
+
+    /**
+     * @brief adds a sequence command that holds back all following commands
+     * until the specified user action has completed. Use this when a motion
+     * depends on an action, e.g. driving off only after the claw has closed.
+     * 
+     * @param id id returned by addAction()
+     */
+    virtual el::retcode waitForAction(action_id_t id);
+
+    /**
+     * @return true - the user action has completed
+     * @return false - the user action is waiting or running
+     */
+    virtual bool actionComplete(action_id_t id);
+
+    /**
+     * @brief blocks until the specified user action has completed
+     * 
+     * @param id id returned by addAction()
+     */
+    virtual el::retcode awaitActionComplete(action_id_t id);
+
+    /**
+     * @brief configures the detection of stalled or slipping wheels. While
+     * enabled, the wheel speeds are compared with the expected ones every control
+     * cycle. If a wheel is stuck, the active command is aborted, the pose is corrected
+     * to the distance actually travelled and the stall handler is called.
+     * Requires getWheelState() to be implemented by the robot.
+     * 
+     * @param config detection parameters
+     * @retval ok - configuration applied
+     * @retval nak - the robot doesn't report its wheel state, detection is inactive
+     * @retval err - invalid configuration
+     */
+    virtual el::retcode setStallDetection(const stall_config_t &config);
+
+    /**
+     * @brief sets a function that is called when a stall is detected, e.g. to
+     * add recovery commands. It is called from the sequence thread with the
+     * command queue locked, so it has to return quickly. Commands can be added from it.
+     * 
+     * @param handler function called with the stall details (empty to remove)
+     */
+    virtual void setStallHandler(std::function<void(const stall_event_t &)> handler);
+
+    /**
+     * @brief gets the most recent stall
+     * 
+     * @param event set to the last stall
+     * @retval ok - event returned
+     * @retval nak - no stall detected since initialization
+     */
+    virtual el::retcode getLastStall(stall_event_t &event);
+
+    /**
+     * @return uint64_t number of stalls detected since initialization
+     */
+    virtual uint64_t getStallCount();
+
+    /**
+     * @return uint64_t number of commands that couldn't be started since
+     * initialization (spline commands without a valid trajectory)
+     */
+    virtual uint64_t getFailedCommandCount();
+
+    /**
+     * @brief reports the encoder positions and the wheel speeds that are
+     * expected right now, used for the stall detection and the pose of aborted
+     * splines. The default implementation reports nothing.
+     * 
+     * @param state wheel state
+     * @retval ok - state reported
+     * @retval nak - not supported by the robot
+     */
+    virtual el::retcode getWheelState(wheel_state_t &state);
+
+    /**
+     * @brief locks the command queue. While the lock is held, commands can be
+     * added from the same thread but the sequence doesn't start any of them,
+     * so a group of commands is added in one operation.
+     * 
+     * @return std::unique_lock<std::recursive_mutex> lock on the command queue
+     */
+    virtual std::unique_lock<std::recursive_mutex> lockSequence();
+
     /**
      * @brief starts processing the current sequence queue.
      * 
@@ -197,13 +706,15 @@ public:
     virtual el::retcode startSequence();
 
     /**
-     * @return true no sequence running
+     * @return true no sequence running (motions and user actions)
      * @return false sequence currently running
      */
     virtual bool sequenceComplete();
 
     /**
-     * @brief blocks until the current sequence is completed.
+     * @brief blocks until the current sequence is completed. A thread attached
+     * to a virtual clock leaves the participants while waiting and continues
+     * before any time passes after the completion.
      * 
      * @retval nak - no sequence active
      * @retval ok - sequence complete
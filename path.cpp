@@ -0,0 +1,327 @@
+/**
+ * @file path.cpp
+ * @author melektron
+ * @brief preprocessed dense path with arc length, heading and curvature
+ * tables and a nearest point index for continuous path following
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright FrenchBakery (c) 2023
+ *
+ */
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include "path.hpp"
+
+// number of segments the projection kernel processes per block.
+// The distances of one block are computed in a branch free loop
+// the compiler can vectorize before the minimum is searched.
+#define PROJECTION_BLOCK 64
+
+// minimum grid cell size when deriving it from the sample spacing
+#define MIN_CELL_SIZE_CM 1.0
+
+
+el::retcode Path::build(const std::vector<el::vec2_t> &points, double cell_size)
+{
+    xs.clear();
+    ys.clear();
+    for (const auto &p : points)
+    {
+        if (!xs.empty() && p.x == xs.back() && p.y == ys.back())
+            continue;
+        xs.push_back(p.x);
+        ys.push_back(p.y);
+    }
+    size_t n = xs.size();
+    if (n < 2)
+    {
+        // don't leave the tables of a previous path behind
+        clear();
+        return el::retcode::err;
+    }
+
+    // segment tables and cumulative arc length
+    seg_dx.resize(n - 1);
+    seg_dy.resize(n - 1);
+    seg_inv_len2.resize(n - 1);
+    arc_lengths.resize(n);
+    arc_lengths[0] = 0;
+    for (size_t i = 0; i < n - 1; i++)
+    {
+        seg_dx[i] = xs[i + 1] - xs[i];
+        seg_dy[i] = ys[i + 1] - ys[i];
+        double len2 = seg_dx[i] * seg_dx[i] + seg_dy[i] * seg_dy[i];
+        seg_inv_len2[i] = 1 / len2;
+        arc_lengths[i + 1] = arc_lengths[i] + std::sqrt(len2);
+    }
+
+    // heading from the central difference, one sided at the ends
+    headings.resize(n);
+    headings[0] = std::atan2(seg_dy[0], seg_dx[0]);
+    headings[n - 1] = std::atan2(seg_dy[n - 2], seg_dx[n - 2]);
+    for (size_t i = 1; i < n - 1; i++)
+        headings[i] = std::atan2(seg_dy[i - 1] + seg_dy[i], seg_dx[i - 1] + seg_dx[i]);
+
+    // signed curvature of the circle through three consecutive samples
+    curvatures.assign(n, 0);
+    for (size_t i = 1; i < n - 1; i++)
+    {
+        double cross = seg_dx[i - 1] * seg_dy[i] - seg_dy[i - 1] * seg_dx[i];
+        double ax = xs[i + 1] - xs[i - 1];
+        double ay = ys[i + 1] - ys[i - 1];
+        double l1 = arc_lengths[i] - arc_lengths[i - 1];
+        double l2 = arc_lengths[i + 1] - arc_lengths[i];
+        double l3 = std::sqrt(ax * ax + ay * ay);
+        curvatures[i] = l3 > 0 ? 2 * cross / (l1 * l2 * l3) : 0;
+    }
+    if (n > 2)
+    {
+        curvatures[0] = curvatures[1];
+        curvatures[n - 1] = curvatures[n - 2];
+    }
+
+    if (cell_size <= 0)
+        cell_size = std::max(MIN_CELL_SIZE_CM, 4 * length() / (n - 1));
+    grid_cell_size = cell_size;
+    buildGrid();
+
+    return el::retcode::ok;
+}
+
+void Path::clear()
+{
+    xs.clear();
+    ys.clear();
+    arc_lengths.clear();
+    headings.clear();
+    curvatures.clear();
+    seg_dx.clear();
+    seg_dy.clear();
+    seg_inv_len2.clear();
+    grid_cell_size = 0;
+    grid_origin_x = 0;
+    grid_origin_y = 0;
+    grid_width = 0;
+    grid_height = 0;
+    grid_offsets.clear();
+    grid_segments.clear();
+}
+
+void Path::buildGrid()
+{
+    auto [minx, maxx] = std::minmax_element(xs.begin(), xs.end());
+    auto [miny, maxy] = std::minmax_element(ys.begin(), ys.end());
+    grid_origin_x = *minx;
+    grid_origin_y = *miny;
+    grid_width = (long)((*maxx - *minx) / grid_cell_size) + 1;
+    grid_height = (long)((*maxy - *miny) / grid_cell_size) + 1;
+
+    // every segment is entered into all cells its bounding box touches
+    auto for_each_cell = [this](size_t i, auto fn)
+    {
+        long x0 = (long)((std::min(xs[i], xs[i + 1]) - grid_origin_x) / grid_cell_size);
+        long x1 = (long)((std::max(xs[i], xs[i + 1]) - grid_origin_x) / grid_cell_size);
+        long y0 = (long)((std::min(ys[i], ys[i + 1]) - grid_origin_y) / grid_cell_size);
+        long y1 = (long)((std::max(ys[i], ys[i + 1]) - grid_origin_y) / grid_cell_size);
+        for (long cy = y0; cy <= y1; cy++)
+            for (long cx = x0; cx <= x1; cx++)
+                fn(cy * grid_width + cx);
+    };
+
+    // count, prefix sum, fill
+    size_t segments = seg_dx.size();
+    grid_offsets.assign(grid_width * grid_height + 1, 0);
+    for (size_t i = 0; i < segments; i++)
+        for_each_cell(i, [this](long c) { grid_offsets[c + 1]++; });
+    for (size_t c = 1; c < grid_offsets.size(); c++)
+        grid_offsets[c] += grid_offsets[c - 1];
+
+    grid_segments.resize(grid_offsets.back());
+    std::vector<size_t> fill(grid_offsets.begin(), grid_offsets.end() - 1);
+    for (size_t i = 0; i < segments; i++)
+        for_each_cell(i, [this, &fill, i](long c) { grid_segments[fill[c]++] = i; });
+}
+
+void Path::setSearchWindow(double window)
+{
+    search_window = window;
+}
+
+size_t Path::size() const
+{
+    return xs.size();
+}
+
+double Path::length() const
+{
+    return arc_lengths.empty() ? 0 : arc_lengths.back();
+}
+
+size_t Path::segmentAt(double s) const
+{
+    auto it = std::upper_bound(arc_lengths.begin(), arc_lengths.end(), s);
+    size_t i = it == arc_lengths.begin() ? 0 : (it - arc_lengths.begin()) - 1;
+    return std::min(i, seg_dx.size() - 1);
+}
+
+el::vec2_t Path::pointAt(double s) const
+{
+    if (xs.empty())
+        return el::vec2_t();
+    s = std::clamp(s, 0.0, length());
+    size_t i = segmentAt(s);
+    double t = (s - arc_lengths[i]) / (arc_lengths[i + 1] - arc_lengths[i]);
+    return el::vec2_t(xs[i] + t * seg_dx[i], ys[i] + t * seg_dy[i]);
+}
+
+double Path::headingAt(double s) const
+{
+    if (xs.empty())
+        return 0;
+    s = std::clamp(s, 0.0, length());
+    size_t i = segmentAt(s);
+    double t = (s - arc_lengths[i]) / (arc_lengths[i + 1] - arc_lengths[i]);
+    // interpolate along the shorter way around
+    double delta = std::remainder(headings[i + 1] - headings[i], 2 * M_PI);
+    return headings[i] + t * delta;
+}
+
+double Path::curvatureAt(double s) const
+{
+    if (xs.empty())
+        return 0;
+    s = std::clamp(s, 0.0, length());
+    size_t i = segmentAt(s);
+    double t = (s - arc_lengths[i]) / (arc_lengths[i + 1] - arc_lengths[i]);
+    return curvatures[i] + t * (curvatures[i + 1] - curvatures[i]);
+}
+
+void Path::projectRange(double px, double py, size_t first, size_t last, projection_t &best) const
+{
+    double best_d2 = best.distance * best.distance;
+    size_t best_i = std::numeric_limits<size_t>::max();
+    double best_t = 0;
+
+    const double *x = xs.data();
+    const double *y = ys.data();
+    const double *dx = seg_dx.data();
+    const double *dy = seg_dy.data();
+    const double *inv = seg_inv_len2.data();
+
+    double d2[PROJECTION_BLOCK];
+    double tt[PROJECTION_BLOCK];
+    for (size_t block = first; block < last; block += PROJECTION_BLOCK)
+    {
+        size_t count = std::min<size_t>(PROJECTION_BLOCK, last - block);
+        for (size_t k = 0; k < count; k++)
+        {
+            size_t i = block + k;
+            double rx = px - x[i];
+            double ry = py - y[i];
+            double t = (rx * dx[i] + ry * dy[i]) * inv[i];
+            t = std::min(1.0, std::max(0.0, t));
+            double ex = rx - t * dx[i];
+            double ey = ry - t * dy[i];
+            d2[k] = ex * ex + ey * ey;
+            tt[k] = t;
+        }
+        for (size_t k = 0; k < count; k++)
+        {
+            if (d2[k] < best_d2)
+            {
+                best_d2 = d2[k];
+                best_i = block + k;
+                best_t = tt[k];
+            }
+        }
+    }
+
+    if (best_i == std::numeric_limits<size_t>::max())
+        return;
+    best.segment = best_i;
+    best.distance = std::sqrt(best_d2);
+    best.s = arc_lengths[best_i] + best_t * (arc_lengths[best_i + 1] - arc_lengths[best_i]);
+    best.point = el::vec2_t(xs[best_i] + best_t * dx[best_i], ys[best_i] + best_t * dy[best_i]);
+}
+
+Path::projection_t Path::closestPoint(el::vec2_t p) const
+{
+    projection_t best;
+    best.distance = std::numeric_limits<double>::infinity();
+    if (xs.empty())
+        return best;
+
+    long cx = (long)std::floor((p.x - grid_origin_x) / grid_cell_size);
+    long cy = (long)std::floor((p.y - grid_origin_y) / grid_cell_size);
+
+    // rings closer than this don't overlap the grid at all
+    long first_ring = std::max({0L, -cx, cx - (grid_width - 1), -cy, cy - (grid_height - 1)});
+    long last_ring = first_ring + std::max(grid_width, grid_height);
+
+    auto visit = [&](long x, long y)
+    {
+        if (x < 0 || y < 0 || x >= grid_width || y >= grid_height)
+            return;
+        size_t c = y * grid_width + x;
+        for (size_t k = grid_offsets[c]; k < grid_offsets[c + 1]; k++)
+            projectRange(p.x, p.y, grid_segments[k], grid_segments[k] + 1, best);
+    };
+
+    for (long r = first_ring; r <= last_ring; r++)
+    {
+        if (r == 0)
+            visit(cx, cy);
+        else
+        {
+            for (long x = cx - r; x <= cx + r; x++)
+            {
+                visit(x, cy - r);
+                visit(x, cy + r);
+            }
+            for (long y = cy - r + 1; y <= cy + r - 1; y++)
+            {
+                visit(cx - r, y);
+                visit(cx + r, y);
+            }
+        }
+        // every unvisited cell is at least r cells away from p
+        if (best.distance <= r * grid_cell_size)
+            break;
+    }
+
+    return best;
+}
+
+Path::projection_t Path::closestPointNear(el::vec2_t p, double s_hint) const
+{
+    if (xs.empty())
+        return closestPoint(p);
+
+    size_t first = segmentAt(s_hint - search_window);
+    size_t last = segmentAt(s_hint + search_window) + 1;
+
+    projection_t best;
+    best.distance = std::numeric_limits<double>::infinity();
+    projectRange(p.x, p.y, first, last, best);
+
+    // If the closest point is on the window border, the real closest
+    // point might lie outside of it (except at the ends of the path).
+    bool at_start = best.s <= arc_lengths[first] && first > 0;
+    bool at_end = best.s >= arc_lengths[last] && last < seg_dx.size();
+    if (at_start || at_end)
+        return closestPoint(p);
+
+    return best;
+}
+
+Path::projection_t Path::closestPointLinear(el::vec2_t p) const
+{
+    projection_t best;
+    best.distance = std::numeric_limits<double>::infinity();
+    if (!xs.empty())
+        projectRange(p.x, p.y, 0, seg_dx.size(), best);
+    return best;
+}
@@ -0,0 +1,169 @@
+/**
+ * @file path.hpp
+ * @author melektron
+ * @brief preprocessed dense path with arc length, heading and curvature
+ * tables and a nearest point index for continuous path following
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright FrenchBakery (c) 2023
+ *
+ */
+
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <el/retcode.hpp>
+#include <el/vec.hpp>
+
+class Path
+{
+public:
+    /**
+     * @brief result of a nearest point query
+     */
+    struct projection_t
+    {
+        // index of the sample at the start of the segment the point lies on
+        size_t segment = 0;
+        // arc length at the projected point in cm
+        double s = 0;
+        // distance between the query point and the path in cm
+        double distance = 0;
+        // projected point on the path
+        el::vec2_t point;
+    };
+
+protected:
+    // per sample tables (structure of arrays, one entry per sample)
+    std::vector<double> xs;
+    std::vector<double> ys;
+    std::vector<double> arc_lengths;
+    std::vector<double> headings;
+    std::vector<double> curvatures;
+
+    // per segment tables used by the projection kernel
+    // (one entry per segment, i.e. samples - 1)
+    std::vector<double> seg_dx;
+    std::vector<double> seg_dy;
+    std::vector<double> seg_inv_len2;
+
+    // uniform grid over the bounding box of the path. Every cell
+    // stores the segments that touch it in a compressed row layout:
+    // the segments of cell c are grid_segments[grid_offsets[c]..grid_offsets[c + 1]]
+    double grid_cell_size = 0;
+    double grid_origin_x = 0;
+    double grid_origin_y = 0;
+    long grid_width = 0;
+    long grid_height = 0;
+    std::vector<size_t> grid_offsets;
+    std::vector<size_t> grid_segments;
+
+    // arc length searched before and after the hint by closestPointNear()
+    double search_window = 20;
+
+    void buildGrid();
+
+    /**
+     * @brief empties all tables and the grid
+     */
+    void clear();
+
+    /**
+     * @brief projects p onto the segments [first, last) and
+     * updates best if a closer point is found.
+     */
+    void projectRange(double px, double py, size_t first, size_t last, projection_t &best) const;
+
+    /**
+     * @return size_t index of the segment containing arc length s
+     */
+    size_t segmentAt(double s) const;
+
+public:
+    Path() = default;
+
+    /**
+     * @brief builds all tables from a list of sample points. Consecutive
+     * duplicate points are dropped.
+     *
+     * @param points path samples in cm
+     * @param cell_size side length of a spatial index cell in cm. 0 selects
+     * a size based on the average sample spacing.
+     * @retval ok - path built
+     * @retval err - less than two distinct points
+     */
+    el::retcode build(const std::vector<el::vec2_t> &points, double cell_size = 0);
+
+    /**
+     * @brief sets the arc length searched before and after the hint
+     * by closestPointNear(). The window should cover at least the distance the
+     * robot can travel in one control cycle.
+     *
+     * @param window arc length in cm
+     */
+    void setSearchWindow(double window);
+
+    /**
+     * @return size_t number of samples
+     */
+    size_t size() const;
+
+    /**
+     * @return double total arc length of the path in cm
+     */
+    double length() const;
+
+    /**
+     * @return el::vec2_t interpolated position at arc length s
+     * (clamped to the path)
+     */
+    el::vec2_t pointAt(double s) const;
+
+    /**
+     * @return double tangent angle in radians at arc length s
+     */
+    double headingAt(double s) const;
+
+    /**
+     * @return double signed curvature in 1/cm at arc length s
+     * (positive is ccw)
+     */
+    double curvatureAt(double s) const;
+
+    // raw table access
+    const std::vector<double> &getArcLengths() const { return arc_lengths; }
+    const std::vector<double> &getHeadings() const { return headings; }
+    const std::vector<double> &getCurvatures() const { return curvatures; }
+
+    /**
+     * @brief finds the closest point on the entire path using
+     * the spatial index.
+     *
+     * @param p query point
+     */
+    projection_t closestPoint(el::vec2_t p) const;
+
+    /**
+     * @brief finds the closest point on the path searching only the window around
+     * s_hint (usually the result of the previous control cycle). If the result
+     * touches the window border, the search falls back to closestPoint().
+     * Every segment in the window is projected, so the cost grows with the
+     * window size divided by the sample spacing and for a wide window can
+     * exceed that of closestPoint(). The advantage is that the result stays
+     * on the part of the path being tracked where it crosses itself.
+     *
+     * @param p query point
+     * @param s_hint arc length of the last known closest point
+     */
+    projection_t closestPointNear(el::vec2_t p, double s_hint) const;
+
+    /**
+     * @brief reference implementation that projects p onto every segment.
+     * Only meant for validation and benchmarking the indexed queries.
+     *
+     * @param p query point
+     */
+    projection_t closestPointLinear(el::vec2_t p) const;
+};
@@ -0,0 +1,132 @@
+/**
+ * @file realtime.cpp
+ * @author melektron
+ * @brief real time scheduling options and wakeup jitter statistics
+ * for the navigation control thread
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright FrenchBakery (c) 2023
+ *
+ */
+
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <sched.h>
+#include <sys/mman.h>
+#include "realtime.hpp"
+
+
+el::retcode validateRealtimeConfig(const rt_config_t &config)
+{
+    if (config.fifo && (config.priority < sched_get_priority_min(SCHED_FIFO) || config.priority > sched_get_priority_max(SCHED_FIFO)))
+        return el::retcode::err;
+    if (config.cpu < -1 || config.cpu >= CPU_SETSIZE)
+        return el::retcode::err;
+    return el::retcode::ok;
+}
+
+el::retcode applyRealtimeConfig(pthread_t thread, const rt_config_t &config)
+{
+    if (validateRealtimeConfig(config) != el::retcode::ok)
+        return el::retcode::err;
+
+    bool degraded = false;
+
+    if (config.lock_memory && mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+    {
+        std::cout << "realtime: could not lock memory (" << strerror(errno) << "), continuing without" << std::endl;
+        degraded = true;
+    }
+
+    if (config.cpu >= 0)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(config.cpu, &set);
+        int res = pthread_setaffinity_np(thread, sizeof(set), &set);
+        if (res != 0)
+        {
+            std::cout << "realtime: could not pin thread to cpu " << config.cpu << " (" << strerror(res) << "), continuing without" << std::endl;
+            degraded = true;
+        }
+    }
+
+    sched_param param{};
+    int policy = SCHED_OTHER;
+    if (config.fifo)
+    {
+        policy = SCHED_FIFO;
+        param.sched_priority = config.priority;
+    }
+    int res = pthread_setschedparam(thread, policy, &param);
+    if (res != 0)
+    {
+        std::cout << "realtime: could not set scheduling policy (" << strerror(res) << "), continuing with default policy" << std::endl;
+        degraded = true;
+    }
+
+    return degraded ? el::retcode::nak : el::retcode::ok;
+}
+
+
+JitterMonitor::JitterMonitor()
+    : histogram(bucket_count, 0)
+{
+}
+
+void JitterMonitor::addSample(int64_t error_ns)
+{
+    std::unique_lock lock(guard, std::try_to_lock);
+    if (!lock.owns_lock())
+        return;
+
+    if (samples == 0 || error_ns < min_ns)
+        min_ns = error_ns;
+    if (samples == 0 || error_ns > max_ns)
+        max_ns = error_ns;
+    sum_ns += error_ns;
+    samples++;
+
+    size_t bucket = std::clamp<int64_t>(error_ns / 1000, 0, bucket_count - 1);
+    histogram[bucket]++;
+}
+
+jitter_stats_t JitterMonitor::getStats() const
+{
+    std::lock_guard lock(guard);
+    jitter_stats_t stats;
+    stats.samples = samples;
+    if (samples == 0)
+        return stats;
+
+    stats.min_us = min_ns / 1000.0;
+    stats.max_us = max_ns / 1000.0;
+    stats.avg_us = (double)sum_ns / samples / 1000.0;
+
+    // upper edge of the bucket containing the 99th percentile
+    uint64_t rank = (samples * 99 + 99) / 100;
+    uint64_t count = 0;
+    for (size_t i = 0; i < bucket_count; i++)
+    {
+        count += histogram[i];
+        if (count >= rank)
+        {
+            stats.p99_us = std::min<double>(i + 1, stats.max_us);
+            break;
+        }
+    }
+    return stats;
+}
+
+void JitterMonitor::reset()
+{
+    std::lock_guard lock(guard);
+    std::fill(histogram.begin(), histogram.end(), 0);
+    samples = 0;
+    min_ns = 0;
+    max_ns = 0;
+    sum_ns = 0;
+}
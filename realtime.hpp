@@ -0,0 +1,102 @@
+/**
+ * @file realtime.hpp
+ * @author melektron
+ * @brief real time scheduling options and wakeup jitter statistics
+ * for the navigation control thread
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright FrenchBakery (c) 2023
+ *
+ */
+
+#pragma once
+
+#include <mutex>
+#include <vector>
+#include <cstdint>
+#include <pthread.h>
+#include <el/retcode.hpp>
+
+/**
+ * @brief scheduling configuration of the control thread
+ */
+struct rt_config_t
+{
+    // run the thread with the SCHED_FIFO policy
+    bool fifo = false;
+    // SCHED_FIFO priority (1 to 99)
+    int priority = 50;
+    // cpu core to pin the thread to, -1 for no pinning
+    int cpu = -1;
+    // lock all current and future memory pages of the process in RAM
+    bool lock_memory = false;
+};
+
+/**
+ * @brief wakeup error statistics of the control loop.
+ * The error is the time between the deadline and the moment the
+ * thread actually resumed, all values are in microseconds.
+ */
+struct jitter_stats_t
+{
+    uint64_t samples = 0;
+    double min_us = 0;
+    double avg_us = 0;
+    double p99_us = 0;
+    double max_us = 0;
+};
+
+/**
+ * @brief checks a scheduling configuration without applying it
+ *
+ * @param config configuration
+ * @retval ok - priority (if fifo) and cpu index are in range
+ * @retval err - invalid configuration
+ */
+el::retcode validateRealtimeConfig(const rt_config_t &config);
+
+/**
+ * @brief applies a scheduling configuration to a thread. If the process
+ * lacks the privileges for some of the options (CAP_SYS_NICE, RLIMIT_MEMLOCK),
+ * these options are skipped and the thread keeps running with the default policy.
+ *
+ * @param thread thread to configure
+ * @param config configuration
+ * @retval ok - all options applied
+ * @retval nak - some options could not be applied due to missing privileges
+ * @retval err - invalid configuration
+ */
+el::retcode applyRealtimeConfig(pthread_t thread, const rt_config_t &config);
+
+/**
+ * @brief collects wakeup errors in a fixed resolution histogram. Memory
+ * is allocated up front so adding samples never allocates.
+ */
+class JitterMonitor
+{
+    // 1us buckets, samples above the last bucket are counted in it
+    static constexpr size_t bucket_count = 10000;
+
+    mutable std::mutex guard;
+    std::vector<uint64_t> histogram;
+    uint64_t samples = 0;
+    int64_t min_ns = 0;
+    int64_t max_ns = 0;
+    int64_t sum_ns = 0;
+
+public:
+    JitterMonitor();
+
+    /**
+     * @brief records one wakeup error. This never blocks: if the
+     * statistics are currently being read, the sample is dropped.
+     *
+     * @param error_ns time between deadline and wakeup in ns
+     */
+    void addSample(int64_t error_ns);
+
+    jitter_stats_t getStats() const;
+
+    void reset();
+};
@@ -0,0 +1,254 @@
+/**
+ * @file simnav.cpp
+ * @author melektron
+ * @brief simulated navigation implementation that models a differential
+ * drive robot without any hardware
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright FrenchBakery (c) 2023
+ *
+ */
+
+#ifdef __SIMULATION
+
+#include <cmath>
+#include <algorithm>
+
+#include "simnav.hpp"
+
+// the simulated wheels follow any acceleration, this keeps splines comparable to the robots
+#define SIM_WHEEL_ACCELERATION 20 // cm/s^2
+
+SimNav::SimNav(double _wheel_to_center_cm, double _ticks_per_cm, int command_timeout_ms)
+    : ticks_per_cm(_ticks_per_cm),
+      wheel_to_center_cm(_wheel_to_center_cm),
+      command_timeout(command_timeout_ms)
+{
+}
+
+void SimNav::moveTruePose(double delta_l, double delta_r)
+{
+    double distance_l = delta_l / ticks_per_cm * scale_l;
+    double distance_r = delta_r / ticks_per_cm * scale_r;
+    double distance = (distance_l + distance_r) / 2;
+    double angle = (distance_r - distance_l) / (2 * wheel_to_center_cm);
+    // move along the average heading of the step
+    true_pose.position += el::polar_t(true_pose.rotation + angle / 2, distance);
+    true_pose.rotation += angle;
+}
+
+void SimNav::updateWheels()
+{
+    int64_t now = clock->now();
+    double dt = (now - last_update) / 1e9;
+    last_update = now;
+    double previous_l = position_l;
+    double previous_r = position_r;
+
+    if (speed_control)
+    {
+        if (!blocked_l)
+            position_l += speed_l * dt;
+        if (!blocked_r)
+            position_r += speed_r * dt;
+    }
+    else if (moving)
+    {
+        // every wheel moves towards its target at a constant speed,
+        // so both arrive at the same time unless one is blocked
+        auto approach = [dt](double &position, double target, double speed)
+        {
+            double step = speed * dt;
+            if (std::abs(target - position) <= step)
+                position = target;
+            else
+                position += target > position ? step : -step;
+        };
+        if (!blocked_l)
+            approach(position_l, start_l + delta_l, speed_l);
+        if (!blocked_r)
+            approach(position_r, start_r + delta_r, speed_r);
+        moving = position_l != start_l + delta_l || position_r != start_r + delta_r;
+    }
+    moveTruePose(position_l - previous_l, position_r - previous_r);
+}
+
+void SimNav::startMove(double ticks_l, double ticks_r)
+{
+    std::lock_guard lock(sim_guard);
+    updateWheels();
+    speed_control = false;
+    start_l = position_l;
+    start_r = position_r;
+    delta_l = ticks_l;
+    delta_r = ticks_r;
+
+    // the faster wheel turns at the configured speed
+    double ticks = std::max(std::abs(ticks_l), std::abs(ticks_r));
+    double duration = ticks / std::max(configured_speed, 1);
+    speed_l = duration > 0 ? std::abs(ticks_l) / duration : 0;
+    speed_r = duration > 0 ? std::abs(ticks_r) / duration : 0;
+    moving = ticks > 0;
+}
+
+el::retcode SimNav::rawRotateBy(double angle)
+{
+    double distance = angle * wheel_to_center_cm;
+    startMove(-distance * ticks_per_cm, distance * ticks_per_cm);
+    current_rotation += angle;
+    return el::retcode::ok;
+}
+
+el::retcode SimNav::rawDriveDistance(double distance)
+{
+    startMove(distance * ticks_per_cm, distance * ticks_per_cm);
+    current_position += el::polar_t(current_rotation, distance);
+    return el::retcode::ok;
+}
+
+el::retcode SimNav::rawDriveArc(double radius, double angle)
+{
+    double distance = radius * std::abs(angle);
+    double distance_l = distance - angle * wheel_to_center_cm;
+    double distance_r = distance + angle * wheel_to_center_cm;
+    startMove(distance_l * ticks_per_cm, distance_r * ticks_per_cm);
+    moveAlongArc(radius, angle);
+    return el::retcode::ok;
+}
+
+el::retcode SimNav::rawDriveSpeeds(double left, double right)
+{
+    std::lock_guard lock(sim_guard);
+    updateWheels();
+    moving = false;
+    speed_control = true;
+    speed_l = left * ticks_per_cm;
+    speed_r = right * ticks_per_cm;
+    return el::retcode::ok;
+}
+
+double SimNav::getWheelToCenter() const
+{
+    return wheel_to_center_cm;
+}
+
+double SimNav::getMaxWheelSpeed() const
+{
+    return configured_speed / ticks_per_cm;
+}
+
+double SimNav::getMaxWheelAcceleration() const
+{
+    return SIM_WHEEL_ACCELERATION;
+}
+
+el::retcode SimNav::rawStop()
+{
+    std::lock_guard lock(sim_guard);
+    updateWheels();
+    moving = false;
+    speed_control = false;
+    return el::retcode::ok;
+}
+
+bool SimNav::targetReached()
+{
+    std::lock_guard lock(sim_guard);
+    updateWheels();
+    return !moving;
+}
+
+el::retcode SimNav::awaitTargetReached()
+{
+    while (!targetReached())
+        clock->sleepMs(10);
+    return el::retcode::ok;
+}
+
+double SimNav::getTargetProgress()
+{
+    std::lock_guard lock(sim_guard);
+    updateWheels();
+    if (!moving)
+        return 1;
+    // completion of both wheels weighted by their distance, like the real robots
+    double total = std::abs(delta_l) + std::abs(delta_r);
+    double travelled = std::abs(position_l - start_l) + std::abs(position_r - start_r);
+    return std::clamp(travelled / total, 0.0, 1.0);
+}
+
+el::retcode SimNav::awaitTargetPercentage(int percent)
+{
+    while (getTargetProgress() * 100 < std::min(percent, 100))
+        clock->sleepMs(10);
+    return el::retcode::ok;
+}
+
+void SimNav::setWheelScale(double left, double right)
+{
+    std::lock_guard lock(sim_guard);
+    updateWheels();
+    scale_l = left;
+    scale_r = right;
+}
+
+void SimNav::setWheelBlocked(bool left, bool right)
+{
+    std::lock_guard lock(sim_guard);
+    updateWheels();
+    blocked_l = left;
+    blocked_r = right;
+}
+
+el::retcode SimNav::getWheelState(wheel_state_t &state)
+{
+    std::lock_guard lock(sim_guard);
+    updateWheels();
+    state.left_position = position_l;
+    state.right_position = position_r;
+    state.left_distance = position_l / ticks_per_cm;
+    state.right_distance = position_r / ticks_per_cm;
+    if (speed_control)
+    {
+        state.left_speed = std::abs(speed_l);
+        state.right_speed = std::abs(speed_r);
+    }
+    else
+    {
+        // the motors are driven until the targets are reached
+        state.left_speed = moving && position_l != start_l + delta_l ? speed_l : 0;
+        state.right_speed = moving && position_r != start_r + delta_r ? speed_r : 0;
+    }
+    return el::retcode::ok;
+}
+
+void SimNav::setTruePose(const pose_t &pose)
+{
+    std::lock_guard lock(sim_guard);
+    updateWheels();
+    true_pose = pose;
+}
+
+pose_t SimNav::getTruePose()
+{
+    std::lock_guard lock(sim_guard);
+    updateWheels();
+    return true_pose;
+}
+
+double SimNav::getLeftPosition()
+{
+    std::lock_guard lock(sim_guard);
+    updateWheels();
+    return position_l;
+}
+
+double SimNav::getRightPosition()
+{
+    std::lock_guard lock(sim_guard);
+    updateWheels();
+    return position_r;
+}
+
+#endif // __SIMULATION
@@ -0,0 +1,141 @@
+/**
+ * @file simnav.hpp
+ * @author melektron
+ * @brief simulated navigation implementation that models a differential
+ * drive robot without any hardware. Combined with a VirtualClock, missions
+ * run much faster than real time.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright FrenchBakery (c) 2023
+ *
+ */
+
+#pragma once
+
+#ifdef __SIMULATION
+
+#include <mutex>
+#include "../navigation.hpp"
+
+class SimNav : public Navigation
+{
+    const double ticks_per_cm;
+    const double wheel_to_center_cm;
+    const int command_timeout;
+
+    std::mutex sim_guard;
+
+    // simulated encoder positions in ticks
+    double position_l = 0;
+    double position_r = 0;
+
+    // active target: start positions and signed tick deltas
+    double start_l = 0;
+    double start_r = 0;
+    double delta_l = 0;
+    double delta_r = 0;
+    bool moving = false;
+
+    // wheel speeds in ticks/s (signed in direct speed control, unsigned
+    // while moving to a target) and the time the wheel positions were last integrated
+    bool speed_control = false;
+    double speed_l = 0;
+    double speed_r = 0;
+    int64_t last_update = 0;
+
+    // blocked wheels don't turn, like a robot pushing against a wall
+    bool blocked_l = false;
+    bool blocked_r = false;
+
+    // actual pose of the simulated robot. It follows the wheels scaled by
+    // the wheel errors and therefore drifts from the odometry pose.
+    pose_t true_pose;
+    double scale_l = 1;
+    double scale_r = 1;
+
+    /**
+     * @brief integrates the true pose over a change of the wheel positions.
+     * Called with sim_guard locked.
+     */
+    void moveTruePose(double delta_l, double delta_r);
+
+    int getCommandTimeout() override { return command_timeout; }
+
+    /**
+     * @brief moves the simulated wheels to where they are at the current
+     * clock time. Called with sim_guard locked.
+     */
+    void updateWheels();
+
+    /**
+     * @brief starts a simulated move of both wheels. The wheel with the
+     * longer way moves at the configured speed.
+     *
+     * @param ticks_l signed ticks of the left wheel
+     * @param ticks_r signed ticks of the right wheel
+     */
+    void startMove(double ticks_l, double ticks_r);
+
+public:
+    /**
+     * @param wheel_to_center_cm distance from a wheel to the center point of the robot
+     * @param ticks_per_cm encoder ticks per cm of wheel travel
+     * @param command_timeout_ms settle time after every command
+     */
+    SimNav(double wheel_to_center_cm = 8.15, double ticks_per_cm = 85.3, int command_timeout_ms = 100);
+
+    using Navigation::getCurrentPosition;
+    using Navigation::getCurrentRotation;
+
+    using Navigation::setMotorSpeed;
+
+    virtual el::retcode rawRotateBy(double angle) override;
+    virtual el::retcode rawDriveDistance(double distance) override;
+    virtual el::retcode rawStop() override;
+    virtual el::retcode rawDriveArc(double radius, double angle) override;
+    virtual el::retcode rawDriveSpeeds(double left, double right) override;
+    virtual double getWheelToCenter() const override;
+    virtual double getMaxWheelSpeed() const override;
+    virtual double getMaxWheelAcceleration() const override;
+    virtual bool targetReached() override;
+    virtual el::retcode awaitTargetReached() override;
+    virtual double getTargetProgress() override;
+    virtual el::retcode awaitTargetPercentage(int percent) override;
+    virtual el::retcode getWheelState(wheel_state_t &state) override;
+
+    /**
+     * @brief sets the ratio between the actual and the commanded travel of
+     * each wheel (e.g. 1.02 for a slightly larger wheel) to simulate odometry drift
+     */
+    void setWheelScale(double left, double right);
+
+    /**
+     * @brief stops wheels from turning to simulate the robot getting stuck.
+     * Blocked wheels never reach their target.
+     */
+    void setWheelBlocked(bool left, bool right);
+
+    /**
+     * @brief sets the actual pose of the simulated robot, independent of the pose
+     * the navigation believes it is in
+     */
+    void setTruePose(const pose_t &pose);
+
+    /**
+     * @return pose_t actual pose of the simulated robot (ground truth for simulated sensors)
+     */
+    pose_t getTruePose();
+
+    /**
+     * @return double simulated left encoder position in ticks
+     */
+    double getLeftPosition();
+
+    /**
+     * @return double simulated right encoder position in ticks
+     */
+    double getRightPosition();
+};
+
+#endif // __SIMULATION
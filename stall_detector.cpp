@@ -0,0 +1,82 @@
+/**
+ * @file stall_detector.cpp
+ * @author melektron
+ * @brief detects stalled and slipping wheels
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright FrenchBakery (c) 2023
+ *
+ */
+
+#include <cmath>
+#include "stall_detector.hpp"
+
+
+void StallDetector::configure(const stall_config_t &_config)
+{
+    config = _config;
+    samples.clear();
+}
+
+void StallDetector::reset(int64_t now_ns)
+{
+    samples.clear();
+    start_ns = now_ns;
+    armed = true;
+}
+
+void StallDetector::disarm()
+{
+    samples.clear();
+    armed = false;
+}
+
+bool StallDetector::addSample(int64_t now_ns, const wheel_state_t &state, stall_event_t &event)
+{
+    if (!config.enabled || !armed || now_ns - start_ns < (int64_t)config.grace_ms * 1000000)
+        return false;
+
+    // keep exactly one sample that is at least a window old
+    const int64_t window_ns = (int64_t)config.window_ms * 1000000;
+    samples.push_back({now_ns, state});
+    while (samples.size() > 2 && now_ns - samples[1].time_ns >= window_ns)
+        samples.pop_front();
+
+    const auto &first = samples.front();
+    if (now_ns - first.time_ns < window_ns)
+        return false;
+    double dt = (now_ns - first.time_ns) / 1e9;
+
+    // expected speeds averaged over the window
+    double expected_l = 0;
+    double expected_r = 0;
+    for (const auto &sample : samples)
+    {
+        expected_l += sample.state.left_speed;
+        expected_r += sample.state.right_speed;
+    }
+    expected_l /= samples.size();
+    expected_r /= samples.size();
+
+    auto check = [&](double travelled, double expected, bool &flagged, double &ratio, bool &slip)
+    {
+        if (expected < config.min_expected_speed)
+            return;
+        ratio = std::abs(travelled) / dt / expected;
+        if (ratio < config.min_speed_ratio)
+            flagged = true;
+        else if (ratio > config.max_speed_ratio)
+            flagged = slip = true;
+    };
+
+    stall_event_t result;
+    result.time_ns = now_ns;
+    check(state.left_position - first.state.left_position, expected_l, result.left, result.left_ratio, result.slip);
+    check(state.right_position - first.state.right_position, expected_r, result.right, result.right_ratio, result.slip);
+    if (!result.left && !result.right)
+        return false;
+
+    event = result;
+    return true;
+}
@@ -0,0 +1,126 @@
+/**
+ * @file stall_detector.hpp
+ * @author melektron
+ * @brief detects wheels that turn much slower (stall, e.g. the robot is
+ * pushing against a wall) or much faster (slip, e.g. a wheel lost traction)
+ * than the motors are commanded to
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright FrenchBakery (c) 2023
+ *
+ */
+
+#pragma once
+
+#include <deque>
+#include <cstdint>
+#include <el/vec.hpp>
+
+/**
+ * @brief encoder state of the drive motors reported by the robot implementation
+ */
+struct wheel_state_t
+{
+    // encoder positions in ticks
+    double left_position = 0;
+    double right_position = 0;
+    // the encoder positions converted to the distance travelled by the wheels in cm
+    double left_distance = 0;
+    double right_distance = 0;
+    // speed the wheels are expected to turn at right now according to the
+    // command and the motion profile, in ticks/s (unsigned, 0 if they should stand still)
+    double left_speed = 0;
+    double right_speed = 0;
+};
+
+/**
+ * @brief stall and slip detection parameters
+ */
+struct stall_config_t
+{
+    bool enabled = false;
+    // time over which the measured and the expected wheel speeds are averaged
+    int window_ms = 200;
+    // time after the start of a command that isn't checked (motors accelerating)
+    int grace_ms = 150;
+    // a wheel stalls if it turns slower than this fraction of its expected speed
+    double min_speed_ratio = 0.3;
+    // a wheel slips if it turns faster than this multiple of its expected speed
+    double max_speed_ratio = 2.5;
+    // wheels expected to turn slower than this (ticks/s) aren't checked
+    double min_expected_speed = 50;
+    // skip the remaining motion commands of the sequence after a stall.
+    // User actions still run so nothing waits for them forever.
+    bool skip_remaining = false;
+};
+
+/**
+ * @brief description of a detected stall
+ */
+struct stall_event_t
+{
+    // clock time of the detection in ns
+    int64_t time_ns = 0;
+    // wheels that stalled or slipped
+    bool left = false;
+    bool right = false;
+    // true if the wheels turned too fast instead of too slow
+    bool slip = false;
+    // measured speed divided by the expected speed over the window
+    double left_ratio = 1;
+    double right_ratio = 1;
+
+    // the aborted command and how far it got (0 to 1)
+    int command_type = -1;
+    double command_value = 0;
+    double progress = 0;
+    // pose after the correction to the travelled distance
+    el::vec2_t position;
+    double rotation = 0;
+};
+
+class StallDetector
+{
+    struct sample_t
+    {
+        int64_t time_ns;
+        wheel_state_t state;
+    };
+
+    stall_config_t config;
+    std::deque<sample_t> samples;
+    int64_t start_ns = 0;
+    // only the command started by the last reset() is checked
+    bool armed = false;
+
+public:
+    StallDetector() = default;
+
+    void configure(const stall_config_t &config);
+    const stall_config_t &getConfig() const { return config; }
+
+    /**
+     * @brief starts checking a new command
+     *
+     * @param now_ns clock time the command was started
+     */
+    void reset(int64_t now_ns);
+
+    /**
+     * @brief stops checking until the next command is started with reset(),
+     * so a detected stall is only reported once
+     */
+    void disarm();
+
+    /**
+     * @brief adds the wheel state of a control cycle and compares the
+     * wheel speeds over the window
+     *
+     * @param now_ns clock time of the sample
+     * @param state wheel state
+     * @param event filled with the wheels and ratios if a stall is detected
+     * @return true - a wheel stalled or slipped
+     */
+    bool addSample(int64_t now_ns, const wheel_state_t &state, stall_event_t &event);
+};
@@ -0,0 +1,179 @@
+/**
+ * @file telemetry.cpp
+ * @author melektron
+ * @brief shared memory telemetry block that publishes the navigation
+ * state to other processes.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright FrenchBakery (c) 2023
+ *
+ */
+
+#include <cstring>
+#include <ctime>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "telemetry.hpp"
+
+
+static uint64_t monotonicNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+
+TelemetryPublisher::~TelemetryPublisher()
+{
+    close();
+}
+
+el::retcode TelemetryPublisher::open(const char *_name)
+{
+    if (block != nullptr)
+        return el::retcode::err;
+
+    int fd = shm_open(_name, O_CREAT | O_RDWR, 0644);
+    if (fd < 0)
+        return el::retcode::err;
+    if (ftruncate(fd, sizeof(telemetry_block_t)) < 0)
+    {
+        ::close(fd);
+        return el::retcode::err;
+    }
+    void *mem = mmap(nullptr, sizeof(telemetry_block_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mem == MAP_FAILED)
+        return el::retcode::err;
+
+    block = static_cast<telemetry_block_t *>(mem);
+    // mark the block invalid while the layout is initialized
+    block->magic = 0;
+    block->version = TELEMETRY_VERSION;
+    block->sequence.store(0, std::memory_order_relaxed);
+    for (auto &word : block->data)
+        word.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    block->magic = TELEMETRY_MAGIC;
+
+    strncpy(name, _name, sizeof(name) - 1);
+    update_count = 0;
+    return el::retcode::ok;
+}
+
+void TelemetryPublisher::close()
+{
+    if (block == nullptr)
+        return;
+    munmap(block, sizeof(telemetry_block_t));
+    shm_unlink(name);
+    block = nullptr;
+}
+
+void TelemetryPublisher::publish(telemetry_data_t data)
+{
+    if (block == nullptr)
+        return;
+
+    data.timestamp_ns = monotonicNs();
+    data.update_count = ++update_count;
+
+    uint64_t words[telemetry_block_t::data_words];
+    memcpy(words, &data, sizeof(words));
+
+    // seqlock write: odd counter, data, even counter
+    uint64_t seq = block->sequence.load(std::memory_order_relaxed);
+    block->sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < telemetry_block_t::data_words; i++)
+        block->data[i].store(words[i], std::memory_order_relaxed);
+    block->sequence.store(seq + 2, std::memory_order_release);
+}
+
+
+TelemetryReader::~TelemetryReader()
+{
+    close();
+}
+
+el::retcode TelemetryReader::open(const char *name)
+{
+    if (block != nullptr)
+        return el::retcode::err;
+
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+        return el::retcode::nak;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(telemetry_block_t))
+    {
+        ::close(fd);
+        return el::retcode::err;
+    }
+    void *mem = mmap(nullptr, sizeof(telemetry_block_t), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mem == MAP_FAILED)
+        return el::retcode::err;
+
+    block = static_cast<const telemetry_block_t *>(mem);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (block->magic != TELEMETRY_MAGIC || block->version != TELEMETRY_VERSION)
+    {
+        close();
+        return el::retcode::err;
+    }
+    return el::retcode::ok;
+}
+
+void TelemetryReader::close()
+{
+    if (block == nullptr)
+        return;
+    munmap(const_cast<telemetry_block_t *>(block), sizeof(telemetry_block_t));
+    block = nullptr;
+}
+
+el::retcode TelemetryReader::read(telemetry_data_t &out) const
+{
+    if (block == nullptr)
+        return el::retcode::err;
+
+    uint64_t words[telemetry_block_t::data_words];
+    // a write takes well below a microsecond. If the publisher died in the
+    // middle of one, the counter stays odd forever and the reader gives up.
+    for (int attempt = 0; attempt < TELEMETRY_READ_ATTEMPTS; attempt++)
+    {
+        uint64_t before = block->sequence.load(std::memory_order_acquire);
+        if (before & 1)
+        {
+            // let a preempted publisher finish its write
+            std::this_thread::yield();
+            continue;
+        }
+        for (size_t i = 0; i < telemetry_block_t::data_words; i++)
+            words[i] = block->data[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t after = block->sequence.load(std::memory_order_relaxed);
+        if (before != after)
+            continue;
+
+        if (before == 0)
+            return el::retcode::nak;
+        memcpy(&out, words, sizeof(words));
+        return el::retcode::ok;
+    }
+    return el::retcode::nak;
+}
+
+uint64_t TelemetryReader::sequence() const
+{
+    if (block == nullptr)
+        return 0;
+    return block->sequence.load(std::memory_order_acquire) / 2;
+}
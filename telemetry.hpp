@@ -0,0 +1,163 @@
+/**
+ * @file telemetry.hpp
+ * @author melektron
+ * @brief shared memory telemetry block that publishes the navigation
+ * state to other processes. The block is protected by a seqlock so readers
+ * never block the writer and never take a lock themselves.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright FrenchBakery (c) 2023
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <el/retcode.hpp>
+
+#define TELEMETRY_DEFAULT_NAME "/frenchbakery_navigation"
+#define TELEMETRY_MAGIC 0x464e4156  // "FNAV"
+#define TELEMETRY_VERSION 2
+// attempts of a reader to get a consistent snapshot before giving up
+#define TELEMETRY_READ_ATTEMPTS 1000
+
+/**
+ * @brief navigation state snapshot. Only plain 8 byte fields so the
+ * block can be copied word by word.
+ */
+struct telemetry_data_t
+{
+    // CLOCK_MONOTONIC time of the update in ns
+    uint64_t timestamp_ns;
+    // number of updates published since the publisher was created
+    uint64_t update_count;
+
+    // current pose
+    double x;
+    double y;
+    double rotation;
+
+    // type of the command that is currently executing (-1 if none)
+    int64_t command_type;
+    // distance or angle of the current command
+    double command_value;
+    // commands still waiting in the queue
+    uint64_t queue_depth;
+    // commands completed in the current sequence
+    uint64_t commands_completed;
+    // progress of the sequence from 0 to 1
+    double sequence_progress;
+    // 1 if no sequence is running
+    uint64_t sequence_complete;
+    // stalled or slipping wheels detected since initialization
+    uint64_t stall_count;
+};
+
+/**
+ * @brief layout of the shared memory object
+ */
+struct telemetry_block_t
+{
+    uint32_t magic;
+    uint32_t version;
+
+    // seqlock counter. Odd while the writer is updating the data.
+    alignas(64) std::atomic<uint64_t> sequence;
+
+    // data stored as atomic words so concurrent reads are well defined
+    static constexpr size_t data_words = sizeof(telemetry_data_t) / sizeof(uint64_t);
+    std::atomic<uint64_t> data[data_words];
+};
+
+static_assert(sizeof(telemetry_data_t) % sizeof(uint64_t) == 0, "telemetry data must consist of 8 byte fields");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "telemetry requires lock free 64 bit atomics");
+
+/**
+ * @brief creates the shared memory object and writes telemetry updates to it.
+ * There must only be one publisher per object name.
+ */
+class TelemetryPublisher
+{
+    telemetry_block_t *block = nullptr;
+    char name[64] = {0};
+    uint64_t update_count = 0;
+
+public:
+    TelemetryPublisher() = default;
+    ~TelemetryPublisher();
+    TelemetryPublisher(const TelemetryPublisher &) = delete;
+    TelemetryPublisher &operator=(const TelemetryPublisher &) = delete;
+
+    /**
+     * @brief creates (or reuses) and maps the shared memory object
+     *
+     * @param name POSIX shared memory name, must start with a slash
+     * @retval ok - object mapped
+     * @retval err - could not create or map the object
+     */
+    el::retcode open(const char *name = TELEMETRY_DEFAULT_NAME);
+
+    /**
+     * @brief unmaps and removes the shared memory object
+     */
+    void close();
+
+    /**
+     * @brief writes a new snapshot. timestamp_ns and update_count
+     * are filled in by the publisher.
+     *
+     * @param data state to publish
+     */
+    void publish(telemetry_data_t data);
+
+    bool isOpen() const { return block != nullptr; }
+};
+
+/**
+ * @brief maps an existing telemetry object read only and reads
+ * consistent snapshots from it without blocking the publisher.
+ */
+class TelemetryReader
+{
+    const telemetry_block_t *block = nullptr;
+
+public:
+    TelemetryReader() = default;
+    ~TelemetryReader();
+    TelemetryReader(const TelemetryReader &) = delete;
+    TelemetryReader &operator=(const TelemetryReader &) = delete;
+
+    /**
+     * @brief maps the shared memory object of a publisher
+     *
+     * @param name POSIX shared memory name used by the publisher
+     * @retval ok - object mapped
+     * @retval nak - object doesn't exist (jet)
+     * @retval err - object has an incompatible layout or can't be mapped
+     */
+    el::retcode open(const char *name = TELEMETRY_DEFAULT_NAME);
+
+    void close();
+
+    /**
+     * @brief reads the latest consistent snapshot
+     *
+     * @param out snapshot
+     * @retval ok - snapshot read
+     * @retval nak - nothing has been published jet, or the publisher
+     * is stuck in the middle of a write (e.g. the process died)
+     * @retval err - reader not open
+     */
+    el::retcode read(telemetry_data_t &out) const;
+
+    /**
+     * @return uint64_t update counter of the publisher. Can be polled
+     * cheaply to detect new data before calling read().
+     */
+    uint64_t sequence() const;
+
+    bool isOpen() const { return block != nullptr; }
+};
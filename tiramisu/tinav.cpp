@@ -15,7 +15,7 @@
 
 #include <iostream>
 #include <iomanip>
-#include <kipr/time/time.h>
+#include <algorithm>
 
 #include "tinav.hpp"
 
@@ -35,6 +35,13 @@
 #define TURNING_LMULTN -1    // for CCW Turn (+ Angle)
 #define TURNING_RMULTN -1    // for CW Turn  (- Angle)
 
+// approximate time the position controllers take to settle on a target.
+// Closer to the target than this, the wheels are expected to slow down.
+#define APPROACH_TIME_S 0.3
+
+// fastest wheel acceleration that doesn't make the wheels slip
+#define MAX_WHEEL_ACCELERATION 20 // cm/s^2
+
 #define WHEEL_TO_CENTER_CM 11.5  // Distance from the wheel to the center point of the robot (between the two wheels)
 constexpr double __track_circumference = 2 * WHEEL_TO_CENTER_CM * M_PI;
 #define TRACK_CIRCUMFERENCE __track_circumference
@@ -78,6 +85,7 @@ el::retcode TINav::rawRotateBy(double angle)
     double lmult = -distance > 0 ? TURNING_LMULTP : TURNING_LMULTN;
     double rmult = distance > 0 ? TURNING_RMULTP : TURNING_RMULTN;
     engine.setMovementModifiers({lmult, rmult});   // set modifiers to invert one motor
+    startProgressTracking(ticks * std::abs(lmult), ticks * std::abs(rmult));
     engine.moveRelativePosition(configured_speed, ticks);
     current_rotation += angle;
     return el::retcode::ok;
@@ -89,11 +97,89 @@ el::retcode TINav::rawDriveDistance(double distance)
     double lmult = distance > 0 ? STRAIGHT_LMULTP : STRAIGHT_LMULTN;
     double rmult = distance > 0 ? STRAIGHT_RMULTP : STRAIGHT_RMULTN;
     engine.setMovementModifiers({lmult, rmult});    // both motors in the same direction
+    startProgressTracking(ticks * std::abs(lmult), ticks * std::abs(rmult));
     engine.moveRelativePosition(configured_speed, ticks);
     current_position += el::polar_t(current_rotation, distance);
     return el::retcode::ok;
 }
 
+el::retcode TINav::rawDriveArc(double radius, double angle)
+{
+    // wheel travel in cm, the inner wheel covers less distance than the outer one
+    double distance = radius * std::abs(angle);
+    double distance_l = distance - angle * WHEEL_TO_CENTER_CM;
+    double distance_r = distance + angle * WHEEL_TO_CENTER_CM;
+    double ticks_l = std::abs(distance_l * STRAIGHT_TICKS_PER_CM);
+    double ticks_r = std::abs(distance_r * STRAIGHT_TICKS_PER_CM);
+    double ticks = std::max(ticks_l, ticks_r);
+    if (ticks == 0)
+        return el::retcode::ok;
+    
+    // scale the modifiers so both wheels finish at the same time
+    double lmult = (distance_l > 0 ? STRAIGHT_LMULTP : STRAIGHT_LMULTN) * ticks_l / ticks;
+    double rmult = (distance_r > 0 ? STRAIGHT_RMULTP : STRAIGHT_RMULTN) * ticks_r / ticks;
+    engine.setMovementModifiers({lmult, rmult});
+    startProgressTracking(ticks * std::abs(lmult), ticks * std::abs(rmult));
+    engine.moveRelativePosition(configured_speed, ticks);
+    moveAlongArc(radius, angle);
+    return el::retcode::ok;
+}
+
+el::retcode TINav::rawDriveSpeeds(double left, double right)
+{
+    if (!speed_control)
+    {
+        disablePositionControl();
+        speed_control = true;
+    }
+    double ticks_per_cm = STRAIGHT_TICKS_PER_CM;
+    double lmult = left > 0 ? STRAIGHT_LMULTP : -STRAIGHT_LMULTN;
+    double rmult = right > 0 ? STRAIGHT_RMULTP : -STRAIGHT_RMULTN;
+    commanded_speed_l = left * ticks_per_cm * lmult;
+    commanded_speed_r = right * ticks_per_cm * rmult;
+    driveLeftSpeed(commanded_speed_l);
+    driveRightSpeed(commanded_speed_r);
+    return el::retcode::ok;
+}
+
+double TINav::getWheelToCenter() const
+{
+    return WHEEL_TO_CENTER_CM;
+}
+
+double TINav::getMaxWheelSpeed() const
+{
+    // the motor with the largest correction factor reaches the configured speed first
+    double mult = std::max<double>({STRAIGHT_LMULTP, -STRAIGHT_LMULTN, STRAIGHT_RMULTP, -STRAIGHT_RMULTN});
+    return configured_speed / (STRAIGHT_TICKS_PER_CM * mult);
+}
+
+double TINav::getMaxWheelAcceleration() const
+{
+    return MAX_WHEEL_ACCELERATION;
+}
+
+el::retcode TINav::rawStop()
+{
+    // leave direct speed control
+    if (speed_control)
+    {
+        commanded_speed_l = 0;
+        commanded_speed_r = 0;
+        driveLeftSpeed(0);
+        driveRightSpeed(0);
+        resetPositionControllers();
+        enablePositionControl();
+        speed_control = false;
+        return el::retcode::ok;
+    }
+
+    // hold both motors at their current position which ends the target
+    motorl->setAbsoluteTarget(motorl->getPosition());
+    motorr->setAbsoluteTarget(motorr->getPosition());
+    return el::retcode::ok;
+}
+
 bool TINav::targetReached()
 {
     return !engine.sequenceRunning();
@@ -108,18 +194,71 @@ el::retcode TINav::awaitTargetReached()
 
 el::retcode TINav::awaitTargetPercentage(int percent)
 {
-    /*while (true)
-    {
-        int l = motorl->getPercentCompleted();
-        int r = motorr->getPercentCompleted();
-        if ((l+r) / 2 >= std::min(percent, 100))
-            break;
-        msleep(10);
-    }*/
+    while (getTargetProgress() * 100 < std::min(percent, 100))
+        clock->sleepMs(10);
 
     return el::retcode::ok;
 }
 
+void TINav::startProgressTracking(double ticks_l, double ticks_r)
+{
+    start_position_l = motorl->getPosition();
+    start_position_r = motorr->getPosition();
+    target_ticks_l = ticks_l;
+    target_ticks_r = ticks_r;
+}
+
+double TINav::getTargetProgress()
+{
+    if (targetReached())
+        return 1;
+    
+    // completion of both motors weighted by their distance, so a
+    // (nearly) stationary inner wheel on tight arcs doesn't distort the progress
+    double total = target_ticks_l + target_ticks_r;
+    if (total <= 0)
+        return 1;
+    double l = std::abs(motorl->getPosition() - start_position_l);
+    double r = std::abs(motorr->getPosition() - start_position_r);
+    return std::clamp((l + r) / total, 0.0, 1.0);
+}
+
+
+el::retcode TINav::getWheelState(wheel_state_t &state)
+{
+    double position_l = motorl->getPosition();
+    double position_r = motorr->getPosition();
+    state.left_position = position_l;
+    state.right_position = position_r;
+    state.left_distance = position_l / (STRAIGHT_TICKS_PER_CM * STRAIGHT_LMULTP);
+    state.right_distance = position_r / (STRAIGHT_TICKS_PER_CM * STRAIGHT_RMULTP);
+
+    if (speed_control)
+    {
+        state.left_speed = std::abs(commanded_speed_l);
+        state.right_speed = std::abs(commanded_speed_r);
+        return el::retcode::ok;
+    }
+    if (targetReached())
+    {
+        state.left_speed = 0;
+        state.right_speed = 0;
+        return el::retcode::ok;
+    }
+
+    // the engine drives the wheel with the longer distance at the configured speed
+    // and slows down when approaching the target
+    double ticks = std::max(target_ticks_l, target_ticks_r);
+    auto expected = [&](double target_ticks, double travelled)
+    {
+        double speed = ticks > 0 ? configured_speed * target_ticks / ticks : 0;
+        double remaining = std::max(0.0, target_ticks - std::abs(travelled));
+        return std::min(speed, remaining / APPROACH_TIME_S);
+    };
+    state.left_speed = expected(target_ticks_l, position_l - start_position_l);
+    state.right_speed = expected(target_ticks_r, position_r - start_position_r);
+    return el::retcode::ok;
+}
 
 
 void TINav::disablePositionControl()
@@ -23,6 +23,28 @@ class TINav : public Navigation
     std::shared_ptr<kp::CreateMotor> motorl;
     std::shared_ptr<kp::CreateMotor> motorr;
     kp::AggregationEngine engine;
+
+    // motor positions at the start of the active target and
+    // the number of ticks each motor has to move to reach it
+    double start_position_l = 0;
+    double start_position_r = 0;
+    double target_ticks_l = 0;
+    double target_ticks_r = 0;
+
+    // true while the motors are driven by rawDriveSpeeds()
+    bool speed_control = false;
+    // speeds in ticks/s sent to the motors in speed control
+    double commanded_speed_l = 0;
+    double commanded_speed_r = 0;
+
+    /**
+     * @brief stores the current motor positions as the start of
+     * a new target for getTargetProgress()
+     * 
+     * @param ticks_l ticks the left motor has to move
+     * @param ticks_r ticks the right motor has to move
+     */
+    void startProgressTracking(double ticks_l, double ticks_r);
     
     int getCommandTimeout() override { return 600; }
 
@@ -45,9 +67,17 @@ public:
 
     virtual el::retcode rawRotateBy(double angle) override;
     virtual el::retcode rawDriveDistance(double distance) override;
+    virtual el::retcode rawStop() override;
+    virtual el::retcode rawDriveArc(double radius, double angle) override;
+    virtual el::retcode rawDriveSpeeds(double left, double right) override;
+    virtual double getWheelToCenter() const override;
+    virtual double getMaxWheelSpeed() const override;
+    virtual double getMaxWheelAcceleration() const override;
     virtual bool targetReached() override;
     virtual el::retcode awaitTargetReached() override;
+    virtual double getTargetProgress() override;
     virtual el::retcode awaitTargetPercentage(int percent) override;
+    virtual el::retcode getWheelState(wheel_state_t &state) override;
 
     /**
      * @brief disables position control on all motors to allow direct speed driving
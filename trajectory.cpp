@@ -0,0 +1,374 @@
+/**
+ * @file trajectory.cpp
+ * @author melektron
+ * @brief smooth spline trajectories through poses, time parameterized
+ * to respect the velocity and acceleration limits of the wheels
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright FrenchBakery (c) 2023
+ *
+ */
+
+#include <cmath>
+#include <algorithm>
+#include "trajectory.hpp"
+#include "path.hpp"
+
+// number of spline points generated per schedule sample. The spline is
+// sampled finer than the schedule so the curvature estimate is smooth.
+#define SPLINE_OVERSAMPLING 4
+
+// maximum heading change between two schedule samples. Tight curves get
+// shorter steps so the interpolated wheel speeds turn the robot by the right angle.
+#define MAX_HEADING_STEP 0.01 // rad
+
+// shortest spline parameter step of a segment
+#define MIN_PARAMETER_STEP 1e-9
+
+// shortest schedule step relative to the spacing
+#define MIN_STEP_FRACTION 1e-9
+
+// rounds of correcting the schedule where a wheel accelerates too fast
+#define ACCELERATION_ITERATIONS 200
+// relative excess of the acceleration limit that is accepted (rounding errors)
+#define ACCELERATION_TOLERANCE 1e-6
+
+
+/**
+ * @return double angle between the steps a->b and b->c (0 if one of them is empty)
+ */
+static double turnAngle(const el::vec2_t &a, const el::vec2_t &b, const el::vec2_t &c)
+{
+    double ux = b.x - a.x, uy = b.y - a.y;
+    double vx = c.x - b.x, vy = c.y - b.y;
+    if ((ux == 0 && uy == 0) || (vx == 0 && vy == 0))
+        return 0;
+    return std::abs(std::atan2(ux * vy - uy * vx, ux * vx + uy * vy));
+}
+
+/**
+ * @brief samples cubic Hermite segments between the waypoints. The tangent
+ * at a waypoint points in the direction of its rotation and is scaled with
+ * the segment length. A waypoint that is behind the previous one makes the
+ * curve turn around on the way there, either in a tight hairpin or by reversing
+ * its direction (cusp).
+ * Where the curve turns by more than MAX_HEADING_STEP / 2 between two points,
+ * the parameter steps next to it are halved. Hairpins dissolve into small
+ * turns that way, only the cusps remain as sharp corners.
+ */
+static std::vector<el::vec2_t> hermitePoints(const std::vector<pose_t> &waypoints, double spacing)
+{
+    std::vector<el::vec2_t> points;
+    for (size_t i = 0; i + 1 < waypoints.size(); i++)
+    {
+        const auto &p0 = waypoints[i].position;
+        const auto &p1 = waypoints[i + 1].position;
+        double d = (p1 - p0).get_r();
+        double m0x = d * std::cos(waypoints[i].rotation);
+        double m0y = d * std::sin(waypoints[i].rotation);
+        double m1x = d * std::cos(waypoints[i + 1].rotation);
+        double m1y = d * std::sin(waypoints[i + 1].rotation);
+
+        // polynomial coefficients: p(t) = a t^3 + b t^2 + m0 t + p0
+        double ax = 2 * (p0.x - p1.x) + m0x + m1x;
+        double ay = 2 * (p0.y - p1.y) + m0y + m1y;
+        double bx = 3 * (p1.x - p0.x) - 2 * m0x - m1x;
+        double by = 3 * (p1.y - p0.y) - 2 * m0y - m1y;
+        auto pointAt = [&](double t)
+        {
+            return el::vec2_t(((ax * t + bx) * t + m0x) * t + p0.x, ((ay * t + by) * t + m0y) * t + p0.y);
+        };
+
+        int steps = std::max(8, (int)std::ceil(d / spacing * SPLINE_OVERSAMPLING));
+        std::vector<double> ts;
+        for (int k = 0; k <= steps; k++)
+            ts.push_back((double)k / steps);
+
+        std::vector<el::vec2_t> segment;
+        for (bool refined = true; refined;)
+        {
+            segment.clear();
+            for (double t : ts)
+                segment.push_back(pointAt(t));
+
+            refined = false;
+            std::vector<double> next = {ts.front()};
+            for (size_t k = 0; k + 1 < ts.size(); k++)
+            {
+                bool sharp = (k > 0 && turnAngle(segment[k - 1], segment[k], segment[k + 1]) > MAX_HEADING_STEP / 2)
+                    || (k + 2 < ts.size() && turnAngle(segment[k], segment[k + 1], segment[k + 2]) > MAX_HEADING_STEP / 2);
+                if (sharp && ts[k + 1] - ts[k] > MIN_PARAMETER_STEP)
+                {
+                    next.push_back((ts[k] + ts[k + 1]) / 2);
+                    refined = true;
+                }
+                next.push_back(ts[k + 1]);
+            }
+            ts.swap(next);
+        }
+        // the end point is the start of the next segment
+        points.insert(points.end(), segment.begin(), segment.end() - 1);
+    }
+    points.push_back(waypoints.back().position);
+    return points;
+}
+
+/**
+ * @brief splits the curve into parts without reversals. A reversal is
+ * where two consecutive steps point in opposite directions, the point
+ * between them is the last point of a part and the first of the next one.
+ */
+static std::vector<std::vector<el::vec2_t>> splitAtReversals(const std::vector<el::vec2_t> &points)
+{
+    std::vector<std::vector<el::vec2_t>> parts(1);
+    el::vec2_t last_step;
+    for (const auto &p : points)
+    {
+        auto &part = parts.back();
+        if (part.empty())
+        {
+            part.push_back(p);
+            continue;
+        }
+        el::vec2_t step = p - part.back();
+        if (step.x == 0 && step.y == 0)
+            continue;
+        if (part.size() > 1 && step.x * last_step.x + step.y * last_step.y < 0)
+            parts.push_back({part.back()});
+        parts.back().push_back(p);
+        last_step = step;
+    }
+    return parts;
+}
+
+/**
+ * @brief calculates the highest center velocity at the end of a step that
+ * keeps a wheel within the acceleration limit while its speed changes from
+ * v * c0 to v_end * c1 (the wheel accelerates in the direction of its speed at the end)
+ *
+ * @param v center velocity at the start of the step
+ * @param c0 wheel speed factor at the start
+ * @param c1 wheel speed factor at the end
+ * @param k 2 * acceleration limit * step length
+ * @return double velocity limit, negative if the wheel is too fast at the start already
+ */
+static double stepLimit(double v, double c0, double c1, double k)
+{
+    if (c1 < 0)
+    {
+        c0 = -c0;
+        c1 = -c1;
+    }
+    if (c1 == 0)
+        return c0 == 0 || v == 0 ? INFINITY : k / std::abs(c0 * v) - v;
+    // |c1 v1 - c0 v| (v + v1) / 2 ds = a solved for v1
+    double root = std::sqrt((c1 + c0) * (c1 + c0) * v * v + 4 * c1 * k);
+    return (root - (c1 - c0) * v) / (2 * c1);
+}
+
+el::retcode Trajectory::generate(const std::vector<pose_t> &waypoints, const trajectory_limits_t &limits, double spacing)
+{
+    samples.clear();
+    if (waypoints.size() < 2 || spacing <= 0 || limits.wheel_velocity <= 0 || limits.wheel_acceleration <= 0)
+        return el::retcode::err;
+    for (size_t i = 0; i + 1 < waypoints.size(); i++)
+        if (waypoints[i].position.x == waypoints[i + 1].position.x && waypoints[i].position.y == waypoints[i + 1].position.y)
+            return el::retcode::err;
+
+    // The curve leaves the first and enters the last waypoint forward, so
+    // it reverses an even number of times. Every other part is driven backward.
+    auto parts = splitAtReversals(hermitePoints(waypoints, spacing));
+    if (parts.size() % 2 == 0)
+        return el::retcode::err;
+
+    // schedule samples of all parts. At a reversal the robot stops, the
+    // last sample of a part is also the first one of the next part.
+    std::vector<double> curvature;  // change of the rotation per cm of travel
+    std::vector<double> direction;  // 1 forward, -1 backward
+    std::vector<bool> stop;         // robot has to stand still at the sample
+    double rotation = waypoints.front().rotation;
+    for (size_t k = 0; k < parts.size(); k++)
+    {
+        Path path;
+        if (path.build(parts[k]) != el::retcode::ok)
+            return el::retcode::err;
+        double sign = k % 2 ? -1 : 1;
+        double offset = k % 2 ? M_PI : 0;
+
+        // arc lengths of the samples, at least two steps so there is a
+        // sample between start and end where the robot moves
+        double length = path.length();
+        std::vector<double> ss = {0};
+        while (ss.back() < length)
+        {
+            double s = ss.back();
+            double step = std::min(spacing, length - s);
+            if (s == 0 && step >= length)
+                step = length / 2;
+            while (step > spacing * MIN_STEP_FRACTION)
+            {
+                double turn = std::abs(std::remainder(path.headingAt(s + step) - path.headingAt(s), 2 * M_PI));
+                double bend = std::max(std::abs(path.curvatureAt(s)), std::abs(path.curvatureAt(s + step))) * step;
+                if (std::max(turn, bend) <= MAX_HEADING_STEP)
+                    break;
+                step /= 2;
+            }
+            ss.push_back(s + step < length ? s + step : length);
+        }
+
+        size_t first = samples.size();
+        if (k > 0)
+            // continue from the shared sample
+            ss.erase(ss.begin());
+        double s0 = samples.empty() ? 0 : samples.back().s;
+        for (double s : ss)
+        {
+            trajectory_sample_t sample;
+            sample.s = s0 + s;
+            sample.pose.position = path.pointAt(s);
+            // continuous rotation, the robot faces backward on reversed parts
+            rotation += std::remainder(path.headingAt(s) + offset - rotation, 2 * M_PI);
+            sample.pose.rotation = rotation;
+            samples.push_back(sample);
+            direction.push_back(sign);
+            stop.push_back(false);
+        }
+        if (k > 0)
+            first--;
+        stop[first] = true;
+        stop.back() = true;
+
+        // curvature from the sampled rotations, so the wheel speeds turn the robot between them
+        curvature.resize(samples.size());
+        for (size_t i = first; i < samples.size(); i++)
+        {
+            size_t a = i > first ? i - 1 : i;
+            size_t b = i + 1 < samples.size() ? i + 1 : i;
+            double ds = samples[b].s - samples[a].s;
+            curvature[i] = ds > 0 ? (samples[b].pose.rotation - samples[a].pose.rotation) / ds : 0;
+        }
+    }
+    // start and end exactly in the requested poses
+    samples.front().pose = waypoints.front();
+    samples.back().pose = waypoints.back();
+    size_t n = samples.size() - 1;
+
+    // speed of each wheel is the center speed times this factor
+    const double w = limits.wheel_to_center;
+    std::vector<double> left(n + 1);
+    std::vector<double> right(n + 1);
+    for (size_t i = 0; i <= n; i++)
+    {
+        left[i] = direction[i] - curvature[i] * w;
+        right[i] = direction[i] + curvature[i] * w;
+    }
+
+    // center velocity at every sample, limited by the outer wheel speed
+    std::vector<double> v(n + 1);
+    for (size_t i = 0; i <= n; i++)
+        v[i] = stop[i] ? 0 : limits.wheel_velocity / std::max(std::abs(left[i]), std::abs(right[i]));
+
+    auto limitAcceleration = [&]
+    {
+        // forward pass: acceleration limit
+        for (size_t i = 0; i < n; i++)
+        {
+            double k = 2 * limits.wheel_acceleration * (samples[i + 1].s - samples[i].s);
+            for (double u : {stepLimit(v[i], left[i], left[i + 1], k), stepLimit(v[i], right[i], right[i + 1], k)})
+                if (u >= 0)
+                    v[i + 1] = std::min(v[i + 1], u);
+        }
+        // backward pass: deceleration limit
+        for (size_t i = n; i > 0; i--)
+        {
+            double k = 2 * limits.wheel_acceleration * (samples[i].s - samples[i - 1].s);
+            for (double u : {stepLimit(v[i], left[i], left[i - 1], k), stepLimit(v[i], right[i], right[i - 1], k)})
+                if (u >= 0)
+                    v[i - 1] = std::min(v[i - 1], u);
+        }
+    };
+    limitAcceleration();
+
+    // A wheel that changes its direction of rotation within a step can be
+    // too fast on both ends of it. Slow down both ends of such steps
+    // until all wheel accelerations are within the limit.
+    bool limited = false;
+    std::vector<double> factor(n + 1);
+    for (int iteration = 0; iteration < ACCELERATION_ITERATIONS && !limited; iteration++)
+    {
+        limited = true;
+        std::fill(factor.begin(), factor.end(), 1);
+        for (size_t i = 0; i < n; i++)
+        {
+            double ds = samples[i + 1].s - samples[i].s;
+            double dl = std::abs(v[i + 1] * left[i + 1] - v[i] * left[i]);
+            double dr = std::abs(v[i + 1] * right[i + 1] - v[i] * right[i]);
+            double ratio = std::max(dl, dr) * (v[i] + v[i + 1]) / (2 * ds) / limits.wheel_acceleration;
+            if (ratio <= 1 + ACCELERATION_TOLERANCE)
+                continue;
+            // the wheel accelerations scale with the square of the velocity
+            double f = 1 / std::sqrt(ratio);
+            factor[i] = std::min(factor[i], f);
+            factor[i + 1] = std::min(factor[i + 1], f);
+            limited = false;
+        }
+        for (size_t i = 0; i <= n; i++)
+            v[i] *= factor[i];
+        limitAcceleration();
+    }
+    if (!limited)
+    {
+        samples.clear();
+        return el::retcode::err;
+    }
+
+    // integrate time and derive the wheel speeds
+    samples[0].t = 0;
+    for (size_t i = 0; i <= n; i++)
+    {
+        if (i > 0)
+            samples[i].t = samples[i - 1].t + 2 * (samples[i].s - samples[i - 1].s) / (v[i - 1] + v[i]);
+        samples[i].left_speed = v[i] * left[i];
+        samples[i].right_speed = v[i] * right[i];
+    }
+
+    return el::retcode::ok;
+}
+
+double Trajectory::duration() const
+{
+    return samples.empty() ? 0 : samples.back().t;
+}
+
+double Trajectory::length() const
+{
+    return samples.empty() ? 0 : samples.back().s;
+}
+
+trajectory_sample_t Trajectory::sampleAt(double t) const
+{
+    if (samples.empty())
+        return trajectory_sample_t();
+    if (t <= 0)
+        return samples.front();
+    if (t >= duration())
+        return samples.back();
+
+    auto it = std::upper_bound(samples.begin(), samples.end(), t, [](double t, const trajectory_sample_t &s) { return t < s.t; });
+    const auto &b = *it;
+    const auto &a = *(it - 1);
+    double f = (t - a.t) / (b.t - a.t);
+
+    trajectory_sample_t sample;
+    sample.t = t;
+    sample.s = a.s + f * (b.s - a.s);
+    sample.pose.position = el::vec2_t(
+        a.pose.position.x + f * (b.pose.position.x - a.pose.position.x),
+        a.pose.position.y + f * (b.pose.position.y - a.pose.position.y)
+    );
+    sample.pose.rotation = a.pose.rotation + f * std::remainder(b.pose.rotation - a.pose.rotation, 2 * M_PI);
+    sample.left_speed = a.left_speed + f * (b.left_speed - a.left_speed);
+    sample.right_speed = a.right_speed + f * (b.right_speed - a.right_speed);
+    return sample;
+}
@@ -0,0 +1,102 @@
+/**
+ * @file trajectory.hpp
+ * @author melektron
+ * @brief smooth spline trajectories through poses, time parameterized
+ * to respect the velocity and acceleration limits of the wheels
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright FrenchBakery (c) 2023
+ *
+ */
+
+#pragma once
+
+#include <vector>
+#include <el/retcode.hpp>
+#include <el/vec.hpp>
+
+/**
+ * @brief position and rotation in the root coordinate system
+ */
+struct pose_t
+{
+    el::vec2_t position;
+    // rotation in radians
+    double rotation = 0;
+};
+
+/**
+ * @brief limits of a single wheel and the robot geometry
+ */
+struct trajectory_limits_t
+{
+    // maximum wheel speed in cm/s (0 = limit of the robot, see Navigation::driveSpline())
+    double wheel_velocity = 0;
+    // maximum wheel acceleration in cm/s^2 (0 = limit of the robot)
+    double wheel_acceleration = 0;
+    // distance from a wheel to the center point of the robot in cm
+    double wheel_to_center = 10;
+};
+
+/**
+ * @brief one step of the wheel speed schedule
+ */
+struct trajectory_sample_t
+{
+    // time since the start in s
+    double t = 0;
+    // arc length since the start in cm
+    double s = 0;
+    // pose the robot should be in at this time
+    pose_t pose;
+    // wheel speeds in cm/s
+    double left_speed = 0;
+    double right_speed = 0;
+};
+
+class Trajectory
+{
+    std::vector<trajectory_sample_t> samples;
+
+public:
+    Trajectory() = default;
+
+    /**
+     * @brief fits cubic Hermite splines through the waypoints and calculates
+     * the fastest wheel speed schedule that keeps both wheels within the limits.
+     * The robot starts and ends at rest. The tangent at every waypoint points
+     * in the direction of its rotation, so the robot passes the waypoints with
+     * that heading. A waypoint behind the previous one can make the curve reverse
+     * its direction (e.g. one straight behind the robot with the same heading).
+     * The robot stops at every reversal and drives the part after it backward.
+     *
+     * @param waypoints poses to pass through, including the start pose
+     * @param limits wheel limits and robot geometry (all greater than 0)
+     * @param spacing longest arc length between two schedule samples in cm.
+     * Tight curves are sampled finer.
+     * @retval ok - trajectory generated
+     * @retval err - less than two waypoints, two consecutive waypoints at the
+     * same position, invalid limits or a degenerate curve that can't be driven
+     */
+    el::retcode generate(const std::vector<pose_t> &waypoints, const trajectory_limits_t &limits, double spacing = 1);
+
+    /**
+     * @return double duration of the trajectory in s
+     */
+    double duration() const;
+
+    /**
+     * @return double length of the trajectory in cm
+     */
+    double length() const;
+
+    /**
+     * @brief interpolates the schedule at a point in time
+     *
+     * @param t time since the start in s (clamped to the trajectory)
+     */
+    trajectory_sample_t sampleAt(double t) const;
+
+    const std::vector<trajectory_sample_t> &getSamples() const { return samples; }
+};